@@ -3,19 +3,261 @@
 #include "modules/numerov.h"
 #include "modules/timer.h"
 #include "modules/math.h"
+#include "modules/libblas.h"
 
 // NOTE: Older GNU compilers appears to have used an OpenMP version in which constant objects
 // are shared by default and not required in the shared clause, even if default(none) is used.
 // Later versions seem to require. However, the behavior is not consistent between GNU g++ and
-// LLVM clang++. Here, we define the shared list in advance based on the compiler used. Search
-// for "_Pragma(OMP_PARALLEL_LOOP)" to see where this takes place below (only one loop).
+// LLVM clang++. Here, we define the shared lists in advance based on the compiler used. Search
+// for "_Pragma(OMP_PARALLEL_LOOP)", "_Pragma(OMP_COUNT_LOOP)" and "_Pragma(OMP_TABLE_LOOP)" to
+// see where this takes place below (three loops).
 #if defined(USING_GNU_COMPILER) && (__GNUC__ < 9)
-	#define OMP_PARALLEL_LOOP "omp parallel for default(none) shared(lambda, multipole, result) schedule(static) if(use_omp)"
+	#define OMP_PARALLEL_LOOP "omp parallel for default(none) shared(table, radial_index, overlap, result) schedule(static) if(use_omp)"
+	#define OMP_COUNT_LOOP "omp parallel for default(none) shared(lambda, row_offset) schedule(dynamic) if(use_omp)"
+	#define OMP_TABLE_LOOP "omp parallel for default(none) shared(lambda, row_offset, table) schedule(dynamic) if(use_omp)"
 #else
-	#define OMP_PARALLEL_LOOP "omp parallel for default(none) shared(mass, R, lambda_list, lambda, basis, multipole, result) schedule(static) if(use_omp)"
+	#define OMP_PARALLEL_LOOP "omp parallel for default(none) shared(first, last, column, table, radial_index, overlap, result) schedule(static) if(use_omp)"
+	#define OMP_COUNT_LOOP "omp parallel for default(none) shared(lambda, lambda_index, channel_count, basis, row_offset) schedule(dynamic) if(use_omp)"
+	#define OMP_TABLE_LOOP "omp parallel for default(none) shared(lambda, channel_count, basis, first, row_offset, table) schedule(dynamic) if(use_omp)"
 #endif
 
-constexpr u8 FORMAT_VERSION = 1;
+constexpr u8 FORMAT_VERSION = 4;
+
+struct AngularEntry {
+	mut<u32> channel_a;
+	mut<u32> channel_b;
+	mut<f64> f;
+};
+
+struct AngularTable {
+	Vec<usize> lambda_offset;
+	Vec<AngularEntry> entry;
+};
+
+static usize entry_offset(usize channel_count, usize task)
+{
+	// NOTE: Entries are stored in the order of their grid index (task), after the
+	// header and the block index of every channel (see find_blocks()), regardless
+	// of which MPI process has written them. Each one holds the index, the R value,
+	// and the coupling matrix.
+
+	usize header_size = sizeof(numerov::MAGIC_NUMBER) + sizeof(FORMAT_VERSION)
+	                  + sizeof(usize) + sizeof(Range<f64>) + sizeof(f64) + channel_count*sizeof(usize);
+
+	usize entry_size = sizeof(usize) + sizeof(f64) + channel_count*channel_count*sizeof(f64);
+
+	return header_size + task*entry_size;
+}
+
+static f64 angular_coeff(const numerov::Basis &basis, usize channel_a, usize channel_b, u32 lambda)
+{
+	// NOTE: Percival-Seaton coefficient of a pair of channels, which is zero unless
+	// both have the same J.
+
+	if (basis.list[channel_a].J != basis.list[channel_b].J) {
+		return 0.0;
+	}
+
+	return math::percival_seaton_coeff(basis.list[channel_a].J,
+	                                   basis.list[channel_a].n,
+	                                   basis.list[channel_b].n,
+	                                   basis.list[channel_a].j,
+	                                   basis.list[channel_b].j,
+	                                   basis.list[channel_a].l,
+	                                   basis.list[channel_b].l,
+	                                   lambda, basis.list[channel_a].spin_mult);
+}
+
+static void build_angular_table(const numerov::Basis &basis, const Range<u32> &lambda_list, bool use_omp, AngularTable &table)
+{
+	// NOTE: The Percival-Seaton coefficients do not depend on R, thus they are all
+	// evaluated once, and only the nonzero ones of the upper triangle are kept,
+	// i.e., those of channels with the same J allowed by the triangle and parity
+	// rules of the 3j and 6j symbols. Entries of the n-th lambda are stored from
+	// lambda_offset[n] up to lambda_offset[n + 1], with no channel pair repeated.
+
+	usize channel_count = basis.list.length();
+
+	mut<usize> lambda_count = 0;
+
+	for ([[maybe_unused]] u32 lambda : lambda_list.as_range_inclusive()) {
+		++lambda_count;
+	}
+
+	table.lambda_offset.resize(lambda_count + 1);
+
+	Vec<usize> row_offset(channel_count + 1);
+
+	mut<usize> lambda_index = 0;
+	mut<usize> entry_count = 0;
+
+	for (u32 lambda : lambda_list.as_range_inclusive()) {
+		//
+		// Step 1: Count the nonzero entries of every row.
+		//
+
+		_Pragma(OMP_COUNT_LOOP)
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			mut<usize> count = 0;
+
+			for (mut<usize> channel_b = channel_a; channel_b < channel_count; ++channel_b) {
+				if (lambda_index == 0) {
+					assert(basis.list[channel_a].spin_mult   == basis.list[channel_b].spin_mult);
+					assert(basis.list[channel_a].r_list.min  == basis.list[channel_b].r_list.min);
+					assert(basis.list[channel_a].r_list.step == basis.list[channel_b].r_list.step);
+				}
+
+				if (angular_coeff(basis, channel_a, channel_b, lambda) != 0.0) {
+					++count;
+				}
+			}
+
+			row_offset[channel_a + 1] = count;
+		}
+
+		//
+		// Step 2: Turn the counts into the offset of every row, and fill the rows in
+		// place. Coefficients are evaluated again, rather than kept from step 1, so
+		// that no storage of the size of the whole upper triangle is needed.
+		//
+
+		row_offset[0] = 0;
+
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			row_offset[channel_a + 1] += row_offset[channel_a];
+		}
+
+		usize first = entry_count;
+
+		table.entry.resize(first + row_offset[channel_count]);
+		table.lambda_offset[lambda_index] = first;
+
+		_Pragma(OMP_TABLE_LOOP)
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			mut<usize> index = first + row_offset[channel_a];
+
+			for (mut<usize> channel_b = channel_a; channel_b < channel_count; ++channel_b) {
+				f64 f = angular_coeff(basis, channel_a, channel_b, lambda);
+
+				if (f != 0.0) {
+					table.entry[index] = {as_u32(channel_a), as_u32(channel_b), f};
+					++index;
+				}
+			}
+
+			assert(index == (first + row_offset[channel_a + 1]));
+		}
+
+		entry_count = first + row_offset[channel_count];
+
+		++lambda_index;
+	}
+
+	table.lambda_offset[lambda_count] = entry_count;
+}
+
+static usize find_root(Vec<usize> &root, mut<usize> channel)
+{
+	// NOTE: Disjoint-set lookup with path halving.
+	while (root[channel] != channel) {
+		root[channel] = root[root[channel]];
+		channel = root[channel];
+	}
+
+	return channel;
+}
+
+static usize find_blocks(const AngularTable &table, Vec<usize> &block_index)
+{
+	// NOTE: Two channels belong to the same block if they are coupled, directly or
+	// through other channels, by any nonzero angular coupling of the table. Thus,
+	// the block structure follows from the selection rules alone, and a radial
+	// overlap vanishing at some R does not split a block. Blocks are numbered in
+	// the order of their lowest channel. Returns their count.
+
+	usize channel_count = block_index.length();
+
+	Vec<usize> root(channel_count);
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		root[channel] = channel;
+	}
+
+	for (mut<usize> n = 0; n < table.entry.length(); ++n) {
+		usize root_a = find_root(root, table.entry[n].channel_a);
+		usize root_b = find_root(root, table.entry[n].channel_b);
+
+		// NOTE: The lowest channel is always kept as the root of a block.
+		if (root_a < root_b) {
+			root[root_b] = root_a;
+		} else {
+			root[root_a] = root_b;
+		}
+	}
+
+	mut<usize> count = 0;
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		usize channel_root = find_root(root, channel);
+
+		if (channel_root == channel) {
+			block_index[channel] = count;
+			++count;
+		} else {
+			block_index[channel] = block_index[channel_root];
+		}
+	}
+
+	return count;
+}
+
+static usize find_radial_functions(const numerov::Basis &basis, Vec<usize> &radial_index, Vec<usize> &radial_channel)
+{
+	// NOTE: Channels of the same (n, v) share the same vibrational eigenvector, which
+	// the FGH driver writes once per (j, J, l). Each distinct eigenvector is kept as
+	// that of its first channel (radial_channel), and every channel is mapped to it
+	// (radial_index). Eigenvectors of the same (n, v) are still compared element by
+	// element, thus other basis sets are handled as well. Returns their count.
+
+	usize channel_count = basis.list.length();
+
+	mut<usize> count = 0;
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		const fgh::BasisEntry &entry = basis.list[channel];
+
+		radial_index[channel] = count;
+
+		for (mut<usize> n = 0; n < count; ++n) {
+			const fgh::BasisEntry &other = basis.list[radial_channel[n]];
+
+			if ((entry.n != other.n) || (entry.v != other.v)) {
+				continue;
+			}
+
+			mut<bool> is_same = true;
+
+			for (mut<usize> k = 0; k < entry.eigenvec.length(); ++k) {
+				if (entry.eigenvec[k] != other.eigenvec[k]) {
+					is_same = false;
+					break;
+				}
+			}
+
+			if (is_same) {
+				radial_index[channel] = n;
+				break;
+			}
+		}
+
+		if (radial_index[channel] == count) {
+			radial_channel[count] = channel;
+			++count;
+		}
+	}
+
+	return count;
+}
 
 int main(int argc, char *argv[])
 {
@@ -69,17 +311,23 @@ int main(int argc, char *argv[])
 
 	const numerov::Basis basis(filename);
 
-	Vec<f64> multipole(basis.list[0].eigenvec.length());
-
 	Mat<f64> result(basis.list.length(), basis.list.length());
 
 	//
-	// Output: Open on the master process only. Other processes will write to
-	// temporary *.mpi* files, and their content will be sorted and included
-	// in the master's output at the end.
+	// Output: Created by the master process, and then opened by all processes without
+	// truncation, each one writing the coupling matrices of its own tasks straight
+	// to their position in the file (see entry_offset() and mpi::File).
 	//
 
-	file::Output coupling = toml.output_filename("coupling_matrix", "atom+diatom_coupling_matrix.bin", &mpi);
+	String outname = toml.string("coupling_matrix", "filename", "atom+diatom_coupling_matrix.bin", &mpi);
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		file::Output create(outname.as_cstr());
+	}
+
+	mpi.wait();
+
+	mpi::File coupling(outname.as_cstr());
 
 	//
 	// OpenMP:
@@ -87,6 +335,59 @@ int main(int argc, char *argv[])
 
 	const bool use_omp = toml.value("omp", "use", false, &mpi);
 
+	//
+	// Angular coupling: Built once by every MPI process, using all of its threads,
+	// so that only the radial overlaps of its entries are left for each R.
+	//
+
+	AngularTable table;
+
+	Timer<1> table_clock;
+
+	table_clock.start();
+	build_angular_table(basis, lambda_list, use_omp, table);
+	table_clock.stop();
+
+	Vec<usize> block_index(basis.list.length());
+
+	usize block_count = find_blocks(table, block_index);
+
+	// NOTE: The n-th row holds the Legendre multipole terms of the n-th lambda on the
+	// grid of r values of the basis set, all of them built at once for each R.
+	Mat<f64> multipole(table.lambda_offset.length() - 1, basis.list[0].eigenvec.length());
+
+	//
+	// Radial functions: The overlaps of all pairs of distinct vibrational functions,
+	// for all lambdas, are the matrix product of the (r, function) matrix of their
+	// values, transposed, and the same matrix scaled by the Simpson weights times the
+	// multipole term of each lambda (see math::simpson_weights()). The n-th lambda
+	// is stored from column n times the count of functions on.
+	//
+
+	usize r_count = basis.list[0].eigenvec.length();
+
+	Vec<usize> radial_index(basis.list.length());
+	Vec<usize> radial_channel(basis.list.length());
+
+	usize radial_count = find_radial_functions(basis, radial_index, radial_channel);
+
+	Mat<f64> radial(r_count, radial_count);
+
+	for (mut<usize> n = 0; n < radial_count; ++n) {
+		const fgh::BasisEntry &entry = basis.list[radial_channel[n]];
+
+		for (mut<usize> k = 0; k < r_count; ++k) {
+			radial(k, n) = entry.eigenvec[k];
+		}
+	}
+
+	Vec<f64> weight(r_count);
+
+	math::simpson_weights(basis.list[0].r_list.step, weight);
+
+	Mat<f64> weighted_radial(r_count, multipole.rows()*radial_count);
+	Mat<f64> overlap(radial_count, multipole.rows()*radial_count);
+
 	//
 	// Summary:
 	//
@@ -97,9 +398,13 @@ int main(int argc, char *argv[])
 		coupling.write(basis.list.length());
 		coupling.write(R_list);
 		coupling.write(mass);
+		coupling.write(block_index);
 
 		print::line();
 		print::line("# Atom-diatom reduced mass: ", mass, " a.u.");
+		print::line("# Angular coupling entries: ", table.entry.length(), " (", table_clock[0], " s)");
+		print::line("# Block count: ", block_count);
+		print::line("# Vibrational functions: ", radial_count);
 		print::line('#');
 		print::line("#    grid        MPI proc.                    R (a.u.)                     time (s)");
 		print::line("# ---------------------------------------------------------------------------------");
@@ -116,59 +421,54 @@ int main(int argc, char *argv[])
 		Timer<1> clock;
 		clock.start();
 
-		for (u32 lambda : lambda_list.as_range_inclusive()) {
-			pes.legendre_multipole_term(arrang, lambda, basis.list[0].r_list, R, multipole);
+		result = 0.0;
+
+		for (mut<usize> channel = 0; channel < result.rows(); ++channel) {
+			result(channel, channel) = basis.list[channel].eigenval
+			                         + numerov::centrifugal_term(basis.list[channel].l, mass, R);
+		}
+
+		pes.legendre_multipole_term(arrang, lambda_list, basis.list[0].r_list, R, multipole);
+
+		for (mut<usize> k = 0; k < r_count; ++k) {
+			for (mut<usize> lambda_index = 0; lambda_index < multipole.rows(); ++lambda_index) {
+				f64 factor = weight[k]*multipole(lambda_index, k);
+
+				for (mut<usize> n = 0; n < radial_count; ++n) {
+					weighted_radial(k, lambda_index*radial_count + n) = factor*radial(k, n);
+				}
+			}
+		}
+
+		blas::gemm('t', 'n', radial_count, overlap.cols(), r_count, &radial[0], radial_count,
+		           &weighted_radial[0], weighted_radial.cols(), &overlap[0], overlap.cols());
+
+		for (mut<usize> lambda_index = 0; lambda_index < multipole.rows(); ++lambda_index) {
+			usize column = lambda_index*radial_count;
+
+			usize first = table.lambda_offset[lambda_index];
+			usize last = table.lambda_offset[lambda_index + 1];
 
 			_Pragma(OMP_PARALLEL_LOOP)
-			for (mut<usize> channel_a = 0; channel_a < result.rows(); ++channel_a) {
-
-				f64 barrier = basis.list[channel_a].eigenval
-				            + numerov::centrifugal_term(basis.list[channel_a].l, mass, R);
-
-				for (mut<usize> channel_b = channel_a; channel_b < result.cols(); ++channel_b) {
-					if (lambda == lambda_list.min) {
-						result(channel_a, channel_b) = (channel_b == channel_a? barrier : 0.0);
-
-						assert(basis.list[channel_a].spin_mult   == basis.list[channel_b].spin_mult);
-						assert(basis.list[channel_a].r_list.min  == basis.list[channel_b].r_list.min);
-						assert(basis.list[channel_a].r_list.step == basis.list[channel_b].r_list.step);
-					}
-
-					if (basis.list[channel_a].J != basis.list[channel_b].J) {
-						continue;
-					}
-
-					f64 f = math::percival_seaton_coeff(basis.list[channel_a].J,
-					                                    basis.list[channel_a].n,
-					                                    basis.list[channel_b].n,
-					                                    basis.list[channel_a].j,
-					                                    basis.list[channel_b].j,
-					                                    basis.list[channel_a].l,
-					                                    basis.list[channel_b].l,
-					                                    lambda, basis.list[channel_a].spin_mult);
-					if (f == 0.0) {
-						continue;
-					}
-
-					f64 overlap_ab = math::simpson(basis.list[channel_a].r_list.step,
-					                               multipole,
-					                               basis.list[channel_a].eigenvec,
-					                               basis.list[channel_b].eigenvec);
-
-					// NOTE: Each thread will work on a unique pair of channels, ab.
-					// Thus, there are no race conditions on access to the result matrix.
-
-					result(channel_a, channel_b) += f*overlap_ab;
-
-					if (channel_b != channel_a) {
-						result(channel_b, channel_a) = result(channel_a, channel_b);
-					}
+			for (mut<usize> n = first; n < last; ++n) {
+				const AngularEntry &entry = table.entry[n];
+
+				f64 overlap_ab = overlap(radial_index[entry.channel_a], column + radial_index[entry.channel_b]);
+
+				// NOTE: Each thread will work on a unique pair of channels, ab.
+				// Thus, there are no race conditions on access to the result matrix.
+
+				result(entry.channel_a, entry.channel_b) += entry.f*overlap_ab;
+
+				if (entry.channel_b != entry.channel_a) {
+					result(entry.channel_b, entry.channel_a) = result(entry.channel_a, entry.channel_b);
 				}
 			}
 		}
 
 		clock.stop();
 
+		coupling.seek_set(entry_offset(result.rows(), task));
 		coupling.write(task);
 		coupling.write(R);
 		coupling.write(result);
@@ -185,41 +485,5 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	//
-	// Sorting: If MPI is used, the master process will now open and read all *.mpi*
-	// temporary files copying the data, ordered by ranks, to its own output file.
-	// If the master arrives here first, it needs to wait so that all processes have
-	// finished writing to their temporary files.
-	//
-
-	mpi.wait();
-
-	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
-		filename.resize(2048);
-
-		for (mut<u32> rank = 1; rank < mpi.world_size(); ++rank) {
-			filename.clear();
-			filename.append(coupling.filename.as_cstr(), ".mpi", rank);
-
-			file::Input input(filename.as_cstr());
-
-			while (input.end() == false) {
-				mut<usize> task = 0;
-				input.read(task);
-
-				mut<f64> R = 0.0;
-				input.read(R);
-
-				input.read(result);
-
-				if (task > mpi.last_local_task()) {
-					coupling.write(task);
-					coupling.write(R);
-					coupling.write(result);
-				}
-			}
-		}
-	}
-
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,366 @@
+#include "modules/essentials.h"
+#include "modules/numerov.h"
+#include "modules/timer.h"
+#include "modules/libtoml.h"
+
+constexpr u8 PAD = 24;
+
+struct Bracket {
+	mut<f64> min_energy;
+	mut<f64> max_energy;
+	mut<s64> min_count;
+	mut<s64> max_count;
+};
+
+struct Propagation {
+	Vec<Mat<f64>> potential;
+	Vec<numerov::RatioBatch> ratio;
+	Vec<numerov::RatioBatch> prev_ratio;
+	Vec<numerov::Workspace> workspace;
+};
+
+static void count_levels(const mpi::Frontend &mpi,
+                         numerov::Potential &coupling,
+                         f64 mass,
+                         const Range<f64> &R_list,
+                         const Vec<f64> &energy,
+                         Propagation &prop,
+                         Vec<s64> &level_count)
+{
+	// NOTE: Counts the levels below each energy, i.e., the nodes of the multichannel
+	// wavefunction from the first to the last grid point, with psi = 0 just outside
+	// of them (see numerov::renormalized_nodes()). The energies are shared among MPI
+	// processes in a round-robin fashion, and those of each process are propagated
+	// together as a batch, which is read once per grid point and shared by threads.
+	// The counts of all blocks are summed up.
+
+	usize energy_count = energy.length();
+
+	assert(level_count.length() == energy_count);
+
+	u32 world_size = mpi.world_size();
+
+	mut<usize> local_count = 0;
+
+	for (mut<usize> n = mpi.rank(); n < energy_count; n += world_size) {
+		++local_count;
+	}
+
+	level_count = 0;
+
+	if (local_count > 0) {
+		Vec<f64> local_energy(local_count);
+		Vec<s64> local_level(local_count);
+
+		for (mut<usize> n = 0; n < local_count; ++n) {
+			local_energy[n] = energy[mpi.rank() + n*world_size];
+		}
+
+		//
+		// Step 1: Propagate the ratio matrices of every block, starting from zero.
+		//
+
+		for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+			usize size = coupling.block_size(block);
+
+			numerov::RatioBatch ratio_batch(size, local_count);
+			prop.ratio[block].swap(ratio_batch);
+
+			numerov::RatioBatch prev_ratio_batch(size, local_count);
+			prop.prev_ratio[block].swap(prev_ratio_batch);
+		}
+
+		for (auto R : R_list.indexed()) {
+			const Mat<f64> &potential = coupling[R.index].value;
+
+			for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+				coupling.copy_block(block, potential, prop.potential[block]);
+
+				numerov::renormalized_nodes(mass, R_list.step, local_energy, prop.potential[block],
+				                            prop.workspace, prop.prev_ratio[block], prop.ratio[block], local_level);
+
+				prop.prev_ratio[block].swap(prop.ratio[block]);
+			}
+		}
+
+		//
+		// Step 2: Add the negative eigenvalues of the ratio matrices at the last point.
+		//
+
+		for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+			numerov::negative_count(prop.prev_ratio[block], prop.workspace, local_level);
+		}
+
+		for (mut<usize> n = 0; n < local_count; ++n) {
+			level_count[mpi.rank() + n*world_size] = local_level[n];
+		}
+	}
+
+	//
+	// Step 3: Merge the counts of all processes. Each one has only set its own
+	// energies, thus the master process can simply add them up before sending the
+	// result back.
+	//
+
+	if (world_size > 1) {
+		if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+			Vec<s64> other_count(energy_count);
+
+			for (mut<u32> rank = 1; rank < world_size; ++rank) {
+				mpi.receive(rank, other_count);
+
+				for (mut<usize> n = 0; n < energy_count; ++n) {
+					level_count[n] += other_count[n];
+				}
+			}
+		} else {
+			mpi.send(mpi::MASTER_PROCESS_RANK, level_count);
+		}
+
+		mpi.broadcast(mpi::MASTER_PROCESS_RANK, level_count);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	mpi::Frontend mpi(&argc, &argv);
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		print::line("# ", argv[0]);
+		print::timestamp();
+		print::line();
+	}
+
+	toml::Cin toml;
+
+	//
+	// Coupling potential:
+	//
+
+	c_str potname = toml.string("coupling_matrix", "filename", "atom+diatom_coupling_matrix.bin", &mpi);
+
+	numerov::Potential coupling(potname);
+
+	f64 mass = coupling.reduced_mass();
+
+	usize channel_count = coupling.channel_count();
+
+	Range<f64> R_list = coupling.grid_range();
+
+	//
+	// Energy window: Levels are searched from bound_states.min to bound_states.max,
+	// and each one is located to within bound_states.tolerance by multisection, i.e.,
+	// every bracket holding levels is split by bound_states.batch energies at once,
+	// all of which are propagated together.
+	//
+	// NOTE: The wavefunction vanishes at both ends of the grid. Thus, levels above
+	// the lowest asymptotic threshold, if any, are those of the box spanned by the
+	// grid rather than true bound states.
+	//
+
+	f64 min_energy = toml.value("bound_states", "min", -f64_max, f64_max, 0.0, &mpi);
+	f64 max_energy = toml.value("bound_states", "max", -f64_max, f64_max, 0.0, &mpi);
+
+	if (max_energy <= min_energy) {
+		print::error(WHERE, "Expecting bound_states.min < bound_states.max");
+	}
+
+	f64 tolerance = toml.value("bound_states", "tolerance", 0.0, f64_max, 1.0e-8, &mpi);
+
+	if (tolerance <= 0.0) {
+		print::error(WHERE, "Expecting bound_states.tolerance > 0");
+	}
+
+	u32 batch_size = toml.value("bound_states", "batch", 1u, u32_max, as_u32(max_thread_count())*mpi.world_size(), &mpi);
+
+	//
+	// Summary:
+	//
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		print::line();
+		print::line("# Grid size: ", R_list.count());
+		print::line("# Channel count: ", channel_count);
+		print::line("# Block count: ", coupling.block_count());
+		print::line("# Reduced mass: ", mass, " a.u.");
+		print::line("# OpenMP threads: ", max_thread_count());
+		print::line("# Energy window: ", min_energy, " to ", max_energy, " a.u.");
+		print::line("# Tolerance: ", tolerance, " a.u.");
+		print::line("# Batch size: ", batch_size);
+		print::line("#");
+	}
+
+	//
+	// Blocks and workspaces: As in the Numerov driver, each block is propagated on
+	// its own, and the workspaces of all OpenMP threads are shared by all blocks.
+	//
+
+	usize block_count = coupling.block_count();
+
+	Propagation prop;
+
+	prop.potential.resize(block_count);
+	prop.ratio.resize(block_count);
+	prop.prev_ratio.resize(block_count);
+
+	mut<usize> max_block_size = 0;
+
+	for (mut<usize> block = 0; block < block_count; ++block) {
+		usize size = coupling.block_size(block);
+
+		if (size > max_block_size) {
+			max_block_size = size;
+		}
+
+		prop.potential[block].resize(size, size);
+	}
+
+	u32 workspace_count = max_thread_count();
+
+	#if defined(_OPENMP)
+		omp_set_max_active_levels(2);
+	#endif
+
+	prop.workspace.resize(workspace_count);
+
+	for (mut<u32> thread = 0; thread < workspace_count; ++thread) {
+		numerov::Workspace thread_workspace(max_block_size);
+		prop.workspace[thread].swap(thread_workspace);
+	}
+
+	//
+	// Multisection: Starts from the whole energy window and, at each sweep, splits
+	// every bracket holding levels into equal parts. Parts left without levels are
+	// dropped, and those narrower than the tolerance are kept as they are, which
+	// leaves the brackets in ascending order of energy. A bracket may end up holding
+	// more than one level, e.g., for degenerate levels of different blocks.
+	//
+
+	Vec<f64> energy = {min_energy, max_energy};
+	Vec<s64> level_count(2);
+
+	count_levels(mpi, coupling, mass, R_list, energy, prop, level_count);
+
+	Vec<Bracket> bracket(1);
+
+	bracket[0] = {min_energy, max_energy, level_count[0], level_count[1]};
+
+	mut<usize> bracket_count = (level_count[1] > level_count[0]? 1 : 0);
+	mut<usize> active_count = (max_energy - min_energy > tolerance? bracket_count : 0);
+	mut<usize> sweep = 0;
+
+	while (active_count > 0) {
+		Timer<1> clock;
+
+		clock.start();
+
+		//
+		// Step 1: Place the same number of energies inside every bracket wider than
+		// the tolerance.
+		//
+
+		usize split = std::max<usize>(1, batch_size/active_count);
+
+		energy.resize(split*active_count);
+		level_count.resize(split*active_count);
+
+		mut<usize> index = 0;
+
+		for (mut<usize> n = 0; n < bracket_count; ++n) {
+			f64 width = bracket[n].max_energy - bracket[n].min_energy;
+
+			if (width <= tolerance) {
+				continue;
+			}
+
+			for (mut<usize> k = 1; k <= split; ++k) {
+				energy[index] = bracket[n].min_energy + width*as_f64(k)/as_f64(split + 1);
+				++index;
+			}
+		}
+
+		count_levels(mpi, coupling, mass, R_list, energy, prop, level_count);
+
+		//
+		// Step 2: Keep the parts holding levels.
+		//
+
+		Vec<Bracket> next_bracket(bracket_count*(split + 1));
+
+		mut<usize> next_count = 0;
+
+		index = 0;
+		active_count = 0;
+
+		for (mut<usize> n = 0; n < bracket_count; ++n) {
+			if ((bracket[n].max_energy - bracket[n].min_energy) <= tolerance) {
+				next_bracket[next_count] = bracket[n];
+				++next_count;
+				continue;
+			}
+
+			mut<f64> lower_energy = bracket[n].min_energy;
+			mut<s64> lower_count = bracket[n].min_count;
+
+			for (mut<usize> k = 0; k <= split; ++k) {
+				f64 upper_energy = (k < split? energy[index + k] : bracket[n].max_energy);
+				s64 upper_count = (k < split? level_count[index + k] : bracket[n].max_count);
+
+				if (upper_count > lower_count) {
+					next_bracket[next_count] = {lower_energy, upper_energy, lower_count, upper_count};
+					++next_count;
+
+					if ((upper_energy - lower_energy) > tolerance) {
+						++active_count;
+					}
+				}
+
+				lower_energy = upper_energy;
+				lower_count = upper_count;
+			}
+
+			index += split;
+		}
+
+		bracket.swap(next_bracket);
+		bracket_count = next_count;
+
+		clock.stop();
+
+		++sweep;
+
+		if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+			print::line("# Sweep ", sweep, ": ", energy.length(), " energies, ", bracket_count, " brackets, ",
+			            active_count, " wider than the tolerance, ", clock[0], " s");
+		}
+	}
+
+	//
+	// Levels: Each one at the midpoint of its bracket, with the index of the first
+	// level it holds, counted from the bottom of the spectrum, and as many levels as
+	// the difference of counts at both ends.
+	//
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		mut<s64> total_count = 0;
+
+		for (mut<usize> n = 0; n < bracket_count; ++n) {
+			total_count += bracket[n].max_count - bracket[n].min_count;
+		}
+
+		print::line("#");
+		print::line("# Level count: ", total_count);
+		print::line("#");
+		print::line<PAD, '#'>("Index", "Energy (a.u.)", "Degeneracy", "Uncertainty (a.u.)");
+
+		for (mut<usize> n = 0; n < bracket_count; ++n) {
+			f64 width = bracket[n].max_energy - bracket[n].min_energy;
+
+			print::line<PAD>(bracket[n].min_count,
+			                 0.5*(bracket[n].min_energy + bracket[n].max_energy),
+			                 bracket[n].max_count - bracket[n].min_count, 0.5*width);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,15 +1,1294 @@
 #include "modules/essentials.h"
 #include "modules/numerov.h"
+#include "modules/numerov_io.h"
 #include "modules/timer.h"
 #include "modules/libtoml.h"
 
-constexpr u8 FORMAT_VERSION = 2;
+struct Options {
+	mut<bool> use_log_derivative;
+	mut<bool> use_eigenbasis;
+	mut<f64> prune_tolerance;
+	mut<bool> use_pruning;
+	mut<f64> step_tolerance;
+	mut<u32> max_step_factor;
+	mut<bool> use_adaptive_step;
+	mut<u32> prefetch_window;
+	mut<u32> checkpoint_interval;
+	String checkpoint_prefix;
+	mut<bool> use_restart;
+	mut<u32> energy_chunk;
+	mut<bool> use_dynamic_schedule;
+	mut<bool> use_smatrix;
+	mut<bool> use_ratio_output;
+	Range<f64> match_list;
+	mut<bool> use_match;
+	mut<bool> use_richardson;
+	mut<bool> use_mixed;
+	mut<u32> mixed_interval;
+	mut<f64> mixed_tolerance;
+	mut<f64> start_tolerance;
+	mut<bool> use_adaptive_start;
+	mut<f64> convergence_tolerance;
+	mut<u32> convergence_interval;
+	mut<bool> use_early_stop;
+};
+
+struct Blocks {
+	Vec<Mat<f64>> potential;
+	Vec<Mat<f64>> past_potential;
+	Vec<numerov::Eigenbasis> eigen;
+	Vec<Vec<f64>> threshold;
+	Vec<Vec<usize>> global_start;
+	Vec<numerov::Workspace> workspace;
+};
+
+struct Chunk {
+	Vec<numerov::Job> result;
+	Vec<f64> local_energy;
+	mut<usize> count;
+	mut<usize> active_count;
+	Vec<numerov::RatioBatch> ratio;
+	Vec<numerov::RatioBatch> prev_ratio;
+	Vec<numerov::RatioBatch> coarse_ratio;
+	Vec<numerov::RatioBatch> coarse_prev_ratio;
+	Vec<numerov::ActiveSet> active;
+	Vec<Vec<f64>> deviation;
+	Vec<Vec<usize>> start_index;
+	Vec<usize> first_energy;
+	numerov::RatioBatch react;
+	Vec<u8> has_react;
+	Vec<u8> is_converged;
+	mut<usize> stopped_count;
+	mut<usize> skipped_point_count;
+
+	Chunk(usize chunk_size, usize block_count, usize channel_count):
+		result(chunk_size), local_energy(chunk_size), count(0), active_count(0),
+		ratio(block_count), prev_ratio(block_count), coarse_ratio(block_count), coarse_prev_ratio(block_count),
+		active(block_count), deviation(block_count), start_index(block_count), first_energy(block_count),
+		react(channel_count, 0), has_react(), is_converged(), stopped_count(0), skipped_point_count(0)
+	{
+	}
+};
+
+struct OutputFiles {
+	std::optional<mpi::File> solution;
+	std::optional<mpi::File> smatrix;
+	std::optional<mpi::File> match;
+	std::optional<mpi::File> richardson;
+};
+
+static usize scan_lowest_diagonal(numerov::Potential &coupling,
+                                  const Range<f64> &R_list,
+                                  usize grid_count, f64 min_energy, Vec<Vec<f64>> &lowest)
+{
+	// NOTE: Reads the lowest diagonal element of the coupling matrix of each block,
+	// from the first grid point on, until it has fallen below the given energy in
+	// every block, i.e., past the first classical turning point of all energies, or
+	// up to the last grid point. Returns the number of grid points read.
+
+	usize block_count = coupling.block_count();
+
+	Vec<u8> has_turned(block_count);
+
+	mut<usize> turned_count = 0;
+	mut<usize> scan_count = 0;
+
+	for (mut<usize> block = 0; block < block_count; ++block) {
+		lowest[block].resize(grid_count);
+	}
+
+	for (auto R : R_list.indexed()) {
+		const Mat<f64> &value = coupling[R.index].value;
+
+		for (mut<usize> block = 0; block < block_count; ++block) {
+			mut<f64> min_value = f64_max;
+
+			for (mut<usize> n = 0; n < coupling.block_size(block); ++n) {
+				usize channel = coupling.block_channel(block, n);
+
+				min_value = std::min(min_value, value(channel, channel));
+			}
+
+			lowest[block][R.index] = min_value;
+
+			if ((has_turned[block] == 0) && (min_value <= min_energy)) {
+				has_turned[block] = 1;
+				++turned_count;
+			}
+		}
+
+		scan_count = R.index + 1;
+
+		if (turned_count == block_count) {
+			break;
+		}
+	}
+
+	return scan_count;
+}
+
+static usize find_start(f64 mass, f64 step, f64 total_energy, f64 min_growth,
+                        const Vec<f64> &lowest, usize scan_count)
+{
+	// NOTE: All channels are classically forbidden before the first turning point,
+	// where the lowest diagonal element V falls below the energy, and their WKB
+	// wavefunctions grow at least as fast as exp(kappa R), with kappa = (2m(V - E))^1/2.
+	// The start is the last grid point from which the sum of kappa*step up to the
+	// turning point reaches min_growth, or the first one if there is none. Without
+	// any turning point, i.e., for a block closed everywhere, the last grid point
+	// scanned is used instead, which keeps the start non-increasing with the energy.
+
+	mut<usize> turning = scan_count;
+
+	for (mut<usize> n = 0; n < scan_count; ++n) {
+		if (lowest[n] <= total_energy) {
+			turning = n;
+			break;
+		}
+	}
+
+	mut<f64> growth = 0.0;
+
+	for (mut<usize> n = turning; n > 0; --n) {
+		growth += std::sqrt(2.0*mass*(lowest[n - 1] - total_energy))*step;
+
+		if (growth >= min_growth) {
+			return n - 1;
+		}
+	}
+
+	return 0;
+}
+
+static bool has_recent_start(const Vec<Vec<usize>> &global_start, usize grid_index, usize window)
+{
+	// NOTE: Whether any energy of any block starts within the given number of grid
+	// points up to grid_index. Without the adaptive start, none does.
+
+	for (mut<usize> block = 0; block < global_start.length(); ++block) {
+		for (mut<usize> n = 0; n < global_start[block].length(); ++n) {
+			usize start = global_start[block][n];
+
+			if ((start <= grid_index) && (start + window > grid_index)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static usize check_convergence(f64 mass,
+                               f64 step,
+                               f64 R_max,
+                               f64 tolerance,
+                               const numerov::Basis &basis,
+                               const numerov::Potential &coupling,
+                               const Vec<numerov::RatioBatch> &ratio,
+                               const Vec<numerov::Job> &result,
+                               usize first, usize last,
+                               Vec<numerov::Workspace> &workspace,
+                               numerov::RatioBatch &react, Vec<u8> &has_react, Vec<u8> &is_converged)
+{
+	// NOTE: Matches the local energies from first up to, but not including, last at
+	// R_max, as the S-matrices of the last grid point, and compares their reaction
+	// matrices with those of the previous check, if any, which are then replaced.
+	// An energy has converged when no element of the open-open block changed by
+	// more than the tolerance. Returns the number of converged energies.
+
+	usize channel_count = coupling.channel_count();
+
+	numerov::RatioBatch full_ratio(channel_count, last - first);
+	numerov::RatioBatch next_react(channel_count, last - first);
+
+	Vec<f64> energy(last - first);
+
+	for (mut<usize> n = first; n < last; ++n) {
+		numerov::copy_ratio(coupling, ratio, n, full_ratio[n - first]);
+		energy[n - first] = result[n].energy;
+	}
+
+	numerov::build_react_matrix(mass, step, R_max, energy, full_ratio, basis, workspace, next_react);
+
+	mut<usize> converged_count = 0;
+
+	for (mut<usize> n = first; n < last; ++n) {
+		const Mat<f64> &k = next_react[n - first];
+
+		mut<f64> max_change = 0.0;
+
+		for (mut<usize> a = 0; a < channel_count; ++a) {
+			for (mut<usize> b = 0; b < channel_count; ++b) {
+				bool is_open = (basis.list[a].eigenval < result[n].energy)
+				            && (basis.list[b].eigenval < result[n].energy);
+
+				if (is_open) {
+					max_change = std::max(max_change, std::abs(k(a, b) - react[n](a, b)));
+				}
+			}
+		}
+
+		is_converged[n] = (((has_react[n] == 1) && (max_change <= tolerance))? 1 : 0);
+		converged_count += is_converged[n];
+
+		react[n] = k;
+		has_react[n] = 1;
+	}
+
+	return converged_count;
+}
+
+static void swap_values(Mat<f64> &a, Mat<f64> &b)
+{
+	for (mut<usize> n = 0; n < a.length(); ++n) {
+		std::swap(a[n], b[n]);
+	}
+}
+
+static void swap_energies(usize a, usize b, Chunk &chunk)
+{
+	// NOTE: Swaps all the state of two local energies, i.e., their slots in every
+	// batch, including the optional ones, which are empty when not in use.
+
+	std::swap(chunk.result[a], chunk.result[b]);
+	std::swap(chunk.local_energy[a], chunk.local_energy[b]);
+
+	for (mut<usize> block = 0; block < chunk.ratio.length(); ++block) {
+		swap_values(chunk.ratio[block][a], chunk.ratio[block][b]);
+		swap_values(chunk.prev_ratio[block][a], chunk.prev_ratio[block][b]);
+
+		if (chunk.deviation[block].length() > 0) {
+			std::swap(chunk.deviation[block][a], chunk.deviation[block][b]);
+		}
+
+		if (chunk.start_index[block].length() > 0) {
+			std::swap(chunk.start_index[block][a], chunk.start_index[block][b]);
+		}
+	}
+
+	swap_values(chunk.react[a], chunk.react[b]);
+	std::swap(chunk.has_react[a], chunk.has_react[b]);
+}
+
+static void read_options(toml::Cin &toml, mpi::Frontend &mpi, Options &opt)
+{
+	//
+	// Propagation method: Either the renormalized Numerov (default) or the log-
+	// derivative engine. For the former, if enabled, the coupling matrix is also
+	// diagonalized once per grid point and all energies are propagated in its
+	// eigenbasis.
+	//
+
+	String engine = toml.string("numerov", "engine", "renormalized", &mpi);
+
+	opt.use_log_derivative = (std::strcmp(engine.as_cstr(), "log_derivative") == 0);
+
+	if ((opt.use_log_derivative == false) && (std::strcmp(engine.as_cstr(), "renormalized") != 0)) {
+		print::error(WHERE, "Invalid numerov.engine = ", engine.as_cstr(), "; expected renormalized or log_derivative");
+	}
+
+	opt.use_eigenbasis = toml.value("numerov", "eigenbasis", false, &mpi);
+
+	//
+	// Closed-channel pruning: If the tolerance is positive, asymptotically closed
+	// channels are left out, per energy, of the propagation while their couplings
+	// are negligible compared with their local kinetic energy, and brought back
+	// once they are not (see numerov.cc).
+	//
+
+	opt.prune_tolerance = toml.value("numerov", "prune_tolerance", 0.0, f64_max, 0.0, &mpi);
+
+	opt.use_pruning = (opt.prune_tolerance > 0.0);
+
+	//
+	// Adaptive step: If the tolerance is positive, the step is doubled, up to the
+	// given factor of the grid step, whenever the estimated local error of the
+	// next step allows it (see numerov::step_error()). The error of the current
+	// step is checked at every point, and doublings stop, with a warning, once
+	// that of a doubled step exceeds the tolerance, while the largest one is
+	// reported in the summary. Only grid points of the coupling file are visited,
+	// thus no interpolation is needed, and the last one is always reached. The
+	// ratio file then stores the final step in its grid.
+	//
+
+	opt.step_tolerance = toml.value("numerov", "step_tolerance", 0.0, f64_max, 0.0, &mpi);
+
+	opt.max_step_factor = toml.value("numerov", "max_step_factor", 1u, 1024u, 8u, &mpi);
+
+	opt.use_adaptive_step = (opt.step_tolerance > 0.0);
+
+	//
+	// Prefetch: If the window is positive, coupling matrices of the next grid points
+	// to be visited are read by a background thread while the current one is being
+	// propagated, and each matrix is handed out without copying.
+	//
+
+	opt.prefetch_window = toml.value("numerov", "prefetch_window", 0u, 64u, 2u, &mpi);
+
+	//
+	// Checkpoints: If the interval is positive, each MPI process saves the state
+	// of its propagation every given number of visited grid points, alternating
+	// between two files, so that a complete one is left if the job is killed while
+	// writing the other. On restart, all processes resume from the last grid point
+	// saved by every one of them, or from the beginning if there is none.
+	//
+
+	opt.checkpoint_interval = toml.value("numerov", "checkpoint_interval", 0u, u32_max, 0u, &mpi);
+
+	opt.checkpoint_prefix += toml.string("numerov", "checkpoint", "numerov_checkpoint.bin", &mpi);
+
+	opt.use_restart = toml.value("numerov", "restart", false, &mpi);
+
+	//
+	// Energy scheduling: By default, energies are split evenly among MPI processes
+	// beforehand. If the chunk length is positive and there are other processes,
+	// the master process instead hands out chunks of energies, of at least that
+	// length, to the others as they finish the previous ones (see
+	// numerov::chunk_length()). This balances the load when energies are not
+	// equally expensive, e.g. with pruning, or when processes do not run at the
+	// same speed.
+	//
+
+	opt.energy_chunk = toml.value("numerov", "energy_chunk", 0u, u32_max, 0u, &mpi);
+
+	opt.use_dynamic_schedule = ((opt.energy_chunk > 0) && (mpi.world_size() > 1));
+
+	//
+	// S-matrix: If enabled, each MPI process builds the reaction and scattering matrices
+	// of its own energies right after the propagation, and writes them to the file
+	// otherwise written by the S-matrix driver (smatrix.filename), with the same
+	// layout. The ratio matrices are then only written if also requested.
+	//
+
+	opt.use_smatrix = toml.value("numerov", "smatrix", false, &mpi);
+
+	opt.use_ratio_output = toml.value("numerov", "write_ratio", true, &mpi);
+
+	//
+	// Matching radii: If given, S-matrices are also built during the propagation at
+	// the grid point nearest to each radius from numerov.match.min to numerov.match.max,
+	// and written to their own file (numerov.match.filename, see modules/numerov_io.cc).
+	// Thus, the convergence with respect to R_max is checked in a single run.
+	//
+
+	opt.match_list = toml.range("numerov", "match", 0.0, 0.0, 0.0, &mpi);
+
+	opt.use_match = (opt.match_list.count() > 0);
+
+	//
+	// Richardson extrapolation: If enabled (numerov.richardson.enabled), all energies
+	// are also propagated with twice the grid step, on every other grid point, sharing
+	// the coupling matrices read (and their eigenbasis, if any) with the main one.
+	// Both reaction matrices at the last grid point are then extrapolated, along with
+	// an error estimate per channel, and written to their own file, given by
+	// numerov.richardson.filename (see numerov::write_richardson_entries()). Other
+	// outputs are those of the grid step.
+	//
+
+	opt.use_richardson = toml.value("numerov", "richardson", "enabled", false, &mpi);
+
+	//
+	// Mixed precision: If enabled, the O(N^3) work of every renormalized Numerov
+	// step, i.e., its matrix inversions and products, is carried out in single
+	// precision, while the ratio matrices remain in double precision. Every given
+	// number of visited grid points, the step is instead carried out in double
+	// precision, which corrects the ratio matrices, and the deviation of the mixed
+	// step is measured; energies for which it exceeds the tolerance are propagated
+	// in double precision from then on (see numerov::renormalized_mixed()).
+	//
+
+	String precision = toml.string("numerov", "precision", "double", &mpi);
+
+	opt.use_mixed = (std::strcmp(precision.as_cstr(), "mixed") == 0);
+
+	if ((opt.use_mixed == false) && (std::strcmp(precision.as_cstr(), "double") != 0)) {
+		print::error(WHERE, "Invalid numerov.precision = ", precision.as_cstr(), "; expected double or mixed");
+	}
+
+	opt.mixed_interval = toml.value("numerov", "mixed_interval", 1u, u32_max, 16u, &mpi);
+
+	opt.mixed_tolerance = toml.value("numerov", "mixed_tolerance", 0.0, f64_max, 1.0e-4, &mpi);
+
+	//
+	// Adaptive start: If the tolerance is positive, each energy of each block starts
+	// from a zero ratio matrix at the last grid point where the WKB estimate of the
+	// wavefunction, from the lowest diagonal element of the coupling matrix, is still
+	// below the tolerance relative to its value at the first classical turning point
+	// (see find_start()). All grid points before it are skipped for that energy.
+	//
+
+	opt.start_tolerance = toml.value("numerov", "start_tolerance", 0.0, 1.0, 0.0, &mpi);
+
+	opt.use_adaptive_start = (opt.start_tolerance > 0.0);
+
+	//
+	// Early termination: If the tolerance is positive, every given number of visited
+	// grid points, each energy is matched as at the last grid point, and it is no
+	// longer propagated once no element of the open-open block of its reaction matrix
+	// changed by more than the tolerance since the previous check. Its S-matrix is
+	// then built from the last reaction matrix (see check_convergence()). The other
+	// energies of the process take over its share of threads, and the process moves
+	// on to its next chunk of energies, if any, as soon as all have converged.
+	//
+	// NOTE: Ratio matrices of energies stopped early do not belong to the last grid
+	// point, thus only the S-matrices are written.
+	//
+
+	opt.convergence_tolerance = toml.value("numerov", "convergence_tolerance", 0.0, f64_max, 0.0, &mpi);
+
+	opt.convergence_interval = toml.value("numerov", "convergence_interval", 1u, u32_max, 32u, &mpi);
+
+	opt.use_early_stop = (opt.convergence_tolerance > 0.0);
+}
+
+static void check_options(const Options &opt, const Range<f64> &R_list)
+{
+	// NOTE: Options are checked in the order they are read, each one against those
+	// read before it.
+
+	bool use_checkpoints = ((opt.checkpoint_interval > 0) || opt.use_restart);
+
+	if (opt.use_log_derivative && opt.use_eigenbasis) {
+		print::error(WHERE, "numerov.eigenbasis is only available with the renormalized engine");
+	}
+
+	if (opt.use_pruning && (opt.use_log_derivative || opt.use_eigenbasis)) {
+		print::error(WHERE, "numerov.prune_tolerance is only available with the renormalized engine and no eigenbasis");
+	}
+
+	if (opt.use_adaptive_step && (opt.use_log_derivative || opt.use_pruning)) {
+		print::error(WHERE, "numerov.step_tolerance is only available with the renormalized engine and no pruning");
+	}
+
+	if (opt.use_dynamic_schedule && use_checkpoints) {
+		print::error(WHERE, "numerov.energy_chunk is not available with checkpoints");
+	}
+
+	if ((opt.use_smatrix == false) && (opt.use_ratio_output == false)) {
+		print::error(WHERE, "numerov.write_ratio = false requires numerov.smatrix = true");
+	}
+
+	if (opt.use_match && (opt.use_log_derivative || opt.use_restart)) {
+		print::error(WHERE, "numerov.match is only available with the renormalized engine and no restart");
+	}
+
+	if (opt.use_match && ((opt.match_list.min < R_list.min) || (opt.match_list[opt.match_list.count() - 1] > R_list.max))) {
+		print::error(WHERE, "Expecting matching radii between ", R_list.min, " and ", R_list.max, " a.u. at numerov.match");
+	}
+
+	if (opt.use_richardson && (opt.use_log_derivative || opt.use_pruning || opt.use_adaptive_step)) {
+		print::error(WHERE, "numerov.richardson.enabled is only available with the renormalized engine, no pruning and no adaptive step");
+	}
+
+	if (opt.use_richardson && use_checkpoints) {
+		print::error(WHERE, "numerov.richardson.enabled is not available with checkpoints");
+	}
+
+	if (opt.use_mixed && (opt.use_log_derivative || opt.use_eigenbasis || opt.use_pruning)) {
+		print::error(WHERE, "numerov.precision = mixed is only available with the renormalized engine, no eigenbasis and no pruning");
+	}
+
+	if (opt.use_adaptive_start && (opt.use_log_derivative || opt.use_pruning)) {
+		print::error(WHERE, "numerov.start_tolerance is only available with the renormalized engine and no pruning");
+	}
+
+	if (opt.use_early_stop && (opt.use_log_derivative || opt.use_pruning || opt.use_match || opt.use_richardson)) {
+		print::error(WHERE, "numerov.convergence_tolerance is only available with the renormalized engine, no pruning, no matching radii and no Richardson extrapolation");
+	}
+
+	if (opt.use_early_stop && use_checkpoints) {
+		print::error(WHERE, "numerov.convergence_tolerance is not available with checkpoints");
+	}
+
+	if (opt.use_early_stop && ((opt.use_smatrix == false) || opt.use_ratio_output)) {
+		print::error(WHERE, "numerov.convergence_tolerance requires numerov.smatrix = true and numerov.write_ratio = false");
+	}
+}
+
+static void print_summary(numerov::Potential &coupling, const Options &opt)
+{
+	print::line();
+	print::line("# Grid size: ", coupling.grid_range().count());
+	print::line("# Channel count: ", coupling.channel_count());
+	print::line("# Block count: ", coupling.block_count());
+	print::line("# Reduced mass: ", coupling.reduced_mass(), " a.u.");
+	print::line("# OpenMP threads: ", max_thread_count());
+	print::line("# Engine: ", (opt.use_log_derivative? "log_derivative" : "renormalized"));
+	print::line("# Eigenbasis: ", (opt.use_eigenbasis? "yes" : "no"));
+	print::line("# Pruning tolerance: ", opt.prune_tolerance);
+	print::line("# Step tolerance: ", opt.step_tolerance);
+	print::line("# Prefetch window: ", opt.prefetch_window);
+	print::line("# Checkpoint interval: ", opt.checkpoint_interval);
+	print::line("# Restart: ", (opt.use_restart? "yes" : "no"));
+	print::line("# Energy chunk: ", (opt.use_dynamic_schedule? opt.energy_chunk : 0u));
+	print::line("# S-matrix: ", (opt.use_smatrix? "yes" : "no"));
+	print::line("# Ratio output: ", (opt.use_ratio_output? "yes" : "no"));
+	print::line("# Matching radii: ", opt.match_list.count());
+	print::line("# Richardson extrapolation: ", (opt.use_richardson? "yes" : "no"));
+	print::line("# Precision: ", (opt.use_mixed? "mixed" : "double"));
+	print::line("# Start tolerance: ", opt.start_tolerance);
+	print::line("# Convergence tolerance: ", opt.convergence_tolerance);
+
+	if (opt.use_early_stop) {
+		print::line("# Convergence interval: ", opt.convergence_interval);
+	}
+
+	if (opt.use_mixed) {
+		print::line("# Mixed-precision interval: ", opt.mixed_interval);
+		print::line("# Mixed-precision tolerance: ", opt.mixed_tolerance);
+	}
+
+	print::line("#");
+	print::line("# MPI proc.                  R (a.u.)                  I/O time (s)                prop. time (s)                total time (s)");
+	print::line("# --------------------------------------------------------------------------------------------------------------------------------");
+}
+
+static void open_output_files(toml::Cin &toml,
+                              mpi::Frontend &mpi,
+                              const Options &opt,
+                              const numerov::Potential &coupling,
+                              f64 mass,
+                              const Range<f64> &R_list,
+                              const Range<f64> &energy_list,
+                              const std::optional<numerov::Basis> &basis,
+                              OutputFiles &output)
+{
+	// NOTE: Files are created by the master process, and then opened by all processes
+	// without truncation, each one writing the ratio (or S-) matrices of its own
+	// energies straight to their position in the file (see modules/numerov_io.cc)
+	// with positioned writes (see mpi::File). Thus, no matrix is sent through MPI,
+	// and the master process only writes the headers.
+
+	usize channel_count = coupling.channel_count();
+
+	String solution_filename = toml.string("numerov", "filename", "numerov_ratio_matrix.bin", &mpi);
+
+	String smatrix_filename = toml.string("smatrix", "filename", "smatrix.bin", &mpi);
+
+	String match_filename = toml.string("numerov", "match", "filename", "numerov_match.bin", &mpi);
+
+	String richardson_filename = toml.string("numerov", "richardson", "filename", "numerov_richardson.bin", &mpi);
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		if (opt.use_ratio_output) {
+			file::Output create(solution_filename.as_cstr());
+		}
+
+		if (opt.use_smatrix) {
+			file::Output create(smatrix_filename.as_cstr());
+
+			numerov::write_smatrix_header(create, basis.value(), energy_list.count(), mass);
+		}
+
+		if (opt.use_match) {
+			file::Output create(match_filename.as_cstr());
+
+			numerov::write_match_header(create, channel_count, mass, opt.match_list, energy_list);
+		}
+
+		if (opt.use_richardson) {
+			file::Output create(richardson_filename.as_cstr());
+
+			numerov::write_richardson_header(create, channel_count, mass, R_list, energy_list);
+		}
+	}
+
+	mpi.wait();
+
+	if (opt.use_ratio_output) {
+		output.solution.emplace(solution_filename.as_cstr());
+	}
+
+	if (opt.use_smatrix) {
+		output.smatrix.emplace(smatrix_filename.as_cstr());
+	}
+
+	if (opt.use_match) {
+		output.match.emplace(match_filename.as_cstr());
+	}
+
+	if (opt.use_richardson) {
+		output.richardson.emplace(richardson_filename.as_cstr());
+	}
+}
+
+static usize static_chunk(mpi::Frontend &mpi, const Range<f64> &energy_list, Chunk &chunk)
+{
+	// NOTE: The energies of the process when split evenly beforehand, see
+	// mpi::Frontend::set_tasks(). Returns their count.
+
+	mut<usize> count = 0;
+
+	for (mut<usize> task = mpi.first_local_task(); task <= mpi.last_local_task(); ++task) {
+		extra_step:
+
+		chunk.result[count].index = task;
+		chunk.result[count].energy = energy_list[task];
+
+		chunk.local_energy[count] = energy_list[task];
+		++count;
+
+		if (task == mpi.last_local_task()) {
+			auto index = mpi.extra_task();
+
+			if (index.has_value()) {
+				task = index.value();
+				goto extra_step;
+			}
+		}
+	}
+
+	return count;
+}
+
+static void setup_blocks(numerov::Potential &coupling,
+                         const Options &opt,
+                         f64 mass,
+                         const Range<f64> &R_list,
+                         usize grid_count,
+                         const Range<f64> &energy_list,
+                         const std::optional<numerov::Basis> &basis,
+                         Blocks &blocks)
+{
+	//
+	// Blocks: The coupling matrix is block diagonal whenever channels of different
+	// J (or parity) are present, as recorded in the coupling file. Each block is
+	// propagated independently with its own ratio matrices, with a cost of O(N^3)
+	// per block of N channels rather than per the full coupling matrix.
+	//
+
+	usize block_count = coupling.block_count();
+
+	blocks.potential.resize(block_count);
+	blocks.past_potential.resize(block_count);
+	blocks.eigen.resize(block_count);
+	blocks.threshold.resize(block_count);
+	blocks.global_start.resize(block_count);
+
+	mut<usize> max_block_size = 0;
+
+	for (mut<usize> block = 0; block < block_count; ++block) {
+		usize size = coupling.block_size(block);
+
+		if (size > max_block_size) {
+			max_block_size = size;
+		}
+
+		blocks.potential[block].resize(size, size);
+
+		if (opt.use_adaptive_step) {
+			blocks.past_potential[block].resize(size, size);
+		}
+
+		if (opt.use_eigenbasis) {
+			blocks.eigen[block].value.resize(size);
+			blocks.eigen[block].vector.resize(size, size);
+		}
+
+		if (opt.use_pruning) {
+			blocks.threshold[block].resize(size);
+
+			for (mut<usize> n = 0; n < size; ++n) {
+				blocks.threshold[block][n] = basis->list[coupling.block_channel(block, n)].eigenval;
+			}
+		}
+	}
+
+	//
+	// Adaptive start: The lowest diagonal elements are scanned once for all chunks
+	// of energies, and the start of each energy is found per block as its chunk is
+	// set up (see setup_chunk()). With matching radii, no energy starts after the
+	// first one.
+	//
+
+	if (opt.use_adaptive_start) {
+		Vec<Vec<f64>> lowest_diagonal(block_count);
+
+		usize scan_count = scan_lowest_diagonal(coupling, R_list, grid_count, energy_list.min, lowest_diagonal);
+
+		mut<usize> max_start_index = grid_count - 1;
+
+		for (auto R : R_list.indexed()) {
+			if (opt.use_match && ((R.value + 0.5*R_list.step) > opt.match_list[0])) {
+				max_start_index = R.index;
+				break;
+			}
+		}
+
+		// NOTE: Starts are non-increasing with the energy, and made so along the
+		// energy list in any case. They are found for all energies, by every MPI
+		// process, since the adaptive step depends on all of them.
+		for (mut<usize> block = 0; block < block_count; ++block) {
+			Vec<usize> block_start(energy_list.count());
+
+			for (mut<usize> n = 0; n < energy_list.count(); ++n) {
+				mut<usize> start = find_start(mass, R_list.step, energy_list[n], -std::log(opt.start_tolerance),
+				                              lowest_diagonal[block], scan_count);
+
+				start = std::min(start, max_start_index);
+
+				block_start[n] = ((n > 0)? std::min(start, block_start[n - 1]) : start);
+			}
+
+			blocks.global_start[block].swap(block_start);
+		}
+	}
+
+	//
+	// Workspaces: One per OpenMP thread, each one holding all scratch matrices and
+	// pivot arrays needed by the Numerov routines, and shared by all blocks. Thus,
+	// no memory is allocated during the propagation.
+	//
+	// NOTE: Energies are shared among OpenMP threads, and with fewer energies than
+	// threads, the remaining ones are used by a multithreaded BLAS/LAPACK backend
+	// inside each thread, which requires nested parallelism. Thus, a single MPI
+	// process per node, with as many threads as cores, is enough to use the node.
+	//
 
-struct Job {
-	mut<usize> index;
-	mut<f64> energy;
-	Mat<f64> ratio;
-};
+	u32 workspace_count = max_thread_count();
+
+	#if defined(_OPENMP)
+		omp_set_max_active_levels(2);
+	#endif
+
+	bool use_full_workspace = (opt.use_log_derivative || opt.use_smatrix || opt.use_match || opt.use_richardson);
+
+	blocks.workspace.resize(workspace_count);
+
+	for (mut<u32> thread = 0; thread < workspace_count; ++thread) {
+		numerov::Workspace thread_workspace(use_full_workspace? coupling.channel_count() : max_block_size, opt.use_mixed);
+		blocks.workspace[thread].swap(thread_workspace);
+	}
+}
+
+static void setup_chunk(const numerov::Potential &coupling, const Options &opt, const Blocks &blocks, Chunk &chunk)
+{
+	// NOTE: The ratio batches of every block, and the state of all optional features,
+	// for the local energies of the current chunk. Batches of the previous chunk, if
+	// any, are released when swapped out.
+
+	usize count = chunk.count;
+
+	for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+		usize size = coupling.block_size(block);
+
+		numerov::RatioBatch ratio_batch(size, count);
+		chunk.ratio[block].swap(ratio_batch);
+
+		numerov::RatioBatch prev_ratio_batch(size, count);
+		chunk.prev_ratio[block].swap(prev_ratio_batch);
+
+		if (opt.use_richardson) {
+			numerov::RatioBatch coarse_ratio_batch(size, count);
+			chunk.coarse_ratio[block].swap(coarse_ratio_batch);
+
+			numerov::RatioBatch coarse_prev_ratio_batch(size, count);
+			chunk.coarse_prev_ratio[block].swap(coarse_prev_ratio_batch);
+		}
+
+		if (opt.use_pruning) {
+			numerov::ActiveSet active_set(size, count);
+			chunk.active[block].swap(active_set);
+		}
+
+		// NOTE: Deviations start at zero, i.e., all energies are first propagated in
+		// mixed precision. They are not saved in checkpoints, thus on restart, those
+		// which fell back to double precision are checked again.
+		if (opt.use_mixed) {
+			Vec<f64> block_deviation(count);
+			chunk.deviation[block].swap(block_deviation);
+		}
+
+		// NOTE: Local energies are in ascending order of their index, thus the ones
+		// already started are always the last ones of the batch, from first_energy on,
+		// and are propagated through views of the batches (see propagate_chunk()).
+		if (opt.use_adaptive_start) {
+			Vec<usize> block_start(count);
+
+			for (mut<usize> n = 0; n < count; ++n) {
+				block_start[n] = blocks.global_start[block][chunk.result[n].index];
+			}
+
+			chunk.start_index[block].swap(block_start);
+
+			chunk.first_energy[block] = count;
+		}
+	}
+
+	// NOTE: Energies still propagated are the first active_count ones of the batch,
+	// as those stopped early are moved past them (see swap_energies()). Thus, the
+	// views of the propagation span from first_energy to active_count.
+	chunk.active_count = count;
+
+	numerov::RatioBatch react(coupling.channel_count(), (opt.use_early_stop? count : 0));
+	chunk.react.swap(react);
+
+	Vec<u8> has_react(opt.use_early_stop? count : 0);
+	chunk.has_react.swap(has_react);
+
+	Vec<u8> is_converged(opt.use_early_stop? count : 0);
+	chunk.is_converged.swap(is_converged);
+
+	chunk.stopped_count = 0;
+	chunk.skipped_point_count = 0;
+}
+
+static void restart_chunk(const mpi::Frontend &mpi,
+                          const numerov::Potential &coupling,
+                          const Options &opt,
+                          const Vec<f64> &energy_batch,
+                          Chunk &chunk,
+                          Mat<f64> &past_potential,
+                          Mat<f64> &last_potential,
+                          numerov::Progress &progress)
+{
+	// NOTE: Checkpoints are written in lockstep by all processes, thus the last
+	// complete one of each process differs by at most one from the others, and
+	// the oldest of them is still in one of the two files of every process.
+
+	String checkpoint_file(opt.checkpoint_prefix.length() + 64);
+
+	mut<usize> slot_index[2] = {0, 0};
+
+	for (mut<usize> slot = 0; slot < 2; ++slot) {
+		numerov::checkpoint_filename(opt.checkpoint_prefix.as_cstr(), mpi.rank(), slot, checkpoint_file);
+
+		slot_index[slot] = numerov::find_checkpoint(checkpoint_file.as_cstr(), mpi.world_size(), energy_batch, coupling,
+		                                            opt.use_adaptive_step, opt.use_pruning);
+	}
+
+	mut<usize> restart_index = std::max(slot_index[0], slot_index[1]);
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		for (mut<u32> rank = 1; rank < mpi.world_size(); ++rank) {
+			mut<usize> other_index = 0;
+			mpi.receive(rank, other_index);
+
+			restart_index = std::min(restart_index, other_index);
+		}
+	} else {
+		mpi.send(mpi::MASTER_PROCESS_RANK, restart_index);
+	}
+
+	mpi.broadcast(mpi::MASTER_PROCESS_RANK, 1, &restart_index);
+
+	if (restart_index > 0) {
+		usize slot = ((slot_index[0] == restart_index)? 0 : 1);
+
+		if (slot_index[slot] != restart_index) {
+			print::error(WHERE, "No checkpoint at grid index ", restart_index, " found by MPI process ", mpi.rank());
+		}
+
+		numerov::checkpoint_filename(opt.checkpoint_prefix.as_cstr(), mpi.rank(), slot, checkpoint_file);
+
+		numerov::read_checkpoint(checkpoint_file.as_cstr(), coupling, progress, chunk.ratio, chunk.prev_ratio,
+		                         chunk.active, past_potential, last_potential, opt.use_adaptive_step, opt.use_pruning);
+	}
+
+	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+		if (restart_index > 0) {
+			print::line("# Restarting after R = ", progress.R_max, " a.u. from ", opt.checkpoint_prefix.as_cstr());
+		} else {
+			print::line("# No checkpoint found in ", opt.checkpoint_prefix.as_cstr(), ", starting from the beginning");
+		}
+	}
+}
+
+static numerov::Progress propagate_chunk(const mpi::Frontend &mpi,
+                                         numerov::Potential &coupling,
+                                         const Options &opt,
+                                         f64 mass,
+                                         const Range<f64> &R_list,
+                                         usize grid_count,
+                                         const Range<f64> &energy_list,
+                                         const std::optional<numerov::Basis> &basis,
+                                         Blocks &blocks,
+                                         Chunk &chunk,
+                                         OutputFiles &output)
+{
+	// NOTE: Propagates all local energies of the current chunk over the whole grid,
+	// or until all have converged with the early termination, and returns the final
+	// state of the propagation, i.e., the last grid point visited (R_max) and the
+	// final step.
+
+	usize block_count = coupling.block_count();
+
+	Vec<f64> energy_batch(chunk.count, &chunk.local_energy[0]);
+
+	// NOTE: The current step is a multiple of the grid step, and the potentials of
+	// the last two visited grid points are kept for the error estimate of the
+	// adaptive step.
+	numerov::Progress progress = {0, 0, 1, R_list.step, R_list.min, 0.0, false};
+
+	mut<usize> next_match = 0;
+
+	Mat<f64> past_potential(coupling.channel_count(), coupling.channel_count());
+	Mat<f64> last_potential(coupling.channel_count(), coupling.channel_count());
+
+	String checkpoint_file(opt.checkpoint_prefix.length() + 64);
+
+	std::optional<numerov::PotentialStream> stream;
+
+	if (opt.prefetch_window > 0) {
+		stream.emplace(coupling, opt.prefetch_window);
+	}
+
+	if (opt.use_restart) {
+		restart_chunk(mpi, coupling, opt, energy_batch, chunk, past_potential, last_potential, progress);
+	}
+
+	for (auto R : R_list.indexed()) {
+		if (R.index != progress.next_index) {
+			continue;
+		}
+
+		Timer<2> clock;
+
+		progress.R_max = R.value;
+
+		clock.start();
+		const Mat<f64> &potential = (stream.has_value()? stream.value()[R.index] : coupling[R.index].value);
+		clock.stop();
+
+		clock.start();
+
+		mut<bool> is_doubled = false;
+
+		// NOTE: The error of the current step is estimated at every visited point, so
+		// that regions a doubled step is too large for, e.g., a second well, are
+		// detected. Once the tolerance is exceeded there, the step is no longer
+		// doubled. Errors of the grid step itself are only reported.
+		if (opt.use_adaptive_step && (progress.visit_count >= 2)) {
+			f64 error = numerov::step_error(mass, progress.step, energy_list.min, energy_list.max, progress.step,
+			                                past_potential, last_potential, potential);
+
+			if ((error > opt.step_tolerance) && (progress.multiple > 1) && (progress.is_step_fixed == false)) {
+				progress.is_step_fixed = true;
+
+				if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+					print::line("# WARNING: Estimated step error of ", error, " above the tolerance at R = ", R.value,
+					            " a.u., the step of ", progress.step, " a.u. is no longer doubled");
+				}
+			}
+
+			progress.max_error = std::max(progress.max_error, error);
+		}
+
+		// NOTE: With the adaptive start, the step is not doubled while any energy has
+		// been propagated over fewer than two steps, which the doubling relies upon.
+		// Energies not started yet start later on with the doubled step.
+		if (opt.use_adaptive_step && (progress.visit_count >= 2) && (2*progress.multiple <= opt.max_step_factor)
+		    && (progress.is_step_fixed == false) && ((grid_count - 1 - R.index)%(2*progress.multiple) == 0)
+		    && (has_recent_start(blocks.global_start, R.index, 2*progress.multiple) == false)) {
+			f64 error = numerov::step_error(mass, 2.0*progress.step, energy_list.min, energy_list.max, progress.step,
+			                                past_potential, last_potential, potential);
+
+			is_doubled = (error <= opt.step_tolerance);
+		}
+
+		// NOTE: The last ratio, from the previous visited point to this one, is
+		// converted into the one from the point before it, so that the kernel can
+		// carry on with twice the step.
+		if (is_doubled) {
+			for (mut<usize> block = 0; block < block_count; ++block) {
+				usize first = chunk.first_energy[block];
+
+				if (first == chunk.active_count) {
+					continue;
+				}
+
+				coupling.copy_block(block, past_potential, blocks.past_potential[block]);
+				coupling.copy_block(block, potential, blocks.potential[block]);
+
+				Vec<f64> energy_view(chunk.active_count - first, &energy_batch[first]);
+
+				numerov::RatioBatch prev_ratio_view(chunk.prev_ratio[block], first, chunk.active_count);
+				numerov::RatioBatch ratio_view(chunk.ratio[block], first, chunk.active_count);
+
+				numerov::double_step(mass, progress.step, energy_view, blocks.past_potential[block], blocks.potential[block],
+				                     blocks.workspace, prev_ratio_view, ratio_view);
+			}
+
+			progress.multiple = 2*progress.multiple;
+			progress.step = 2.0*progress.step;
+
+			if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+				print::line("# Step doubled to ", progress.step, " a.u. at R = ", R.value, " a.u.");
+			}
+		}
+
+		if (stream.has_value()) {
+			for (mut<usize> n = 1; n <= opt.prefetch_window; ++n) {
+				if ((R.index + n*progress.multiple) < grid_count) {
+					stream.value().request(R.index + n*progress.multiple);
+				}
+			}
+		}
+
+		for (mut<usize> block = 0; block < block_count; ++block) {
+			coupling.copy_block(block, potential, blocks.potential[block]);
+
+			// NOTE: When swapping the batches, the current ratio batch will hold
+			// garbage data temporarily, but the Numerov routine will only rewrite
+			// it with the updated ratio matrices. We take advantage of this write-
+			// only feature to avoid zeroing the whole batch every step, which can
+			// become expensive.
+			chunk.prev_ratio[block].swap(chunk.ratio[block]);
+
+			// NOTE: Energies not started yet keep the zero ratio matrices of both
+			// batches, which they start from.
+			if (opt.use_adaptive_start) {
+				while ((chunk.first_energy[block] > 0) && (chunk.start_index[block][chunk.first_energy[block] - 1] <= R.index)) {
+					--chunk.first_energy[block];
+				}
+			}
+
+			usize first = chunk.first_energy[block];
+
+			if (first == chunk.active_count) {
+				continue;
+			}
+
+			Vec<f64> energy_view(chunk.active_count - first, &energy_batch[first]);
+
+			numerov::RatioBatch prev_ratio_view(chunk.prev_ratio[block], first, chunk.active_count);
+			numerov::RatioBatch ratio_view(chunk.ratio[block], first, chunk.active_count);
+
+			if (opt.use_log_derivative) {
+				u32 weight = numerov::simpson_weight(R.index, grid_count);
+
+				numerov::log_derivative(mass, progress.step, energy_view, blocks.potential[block], weight, blocks.workspace,
+				                        prev_ratio_view, ratio_view);
+			} else if (opt.use_pruning) {
+				numerov::renormalized(mass, progress.step, energy_view, blocks.potential[block], blocks.threshold[block],
+				                      opt.prune_tolerance, chunk.active[block], blocks.workspace, prev_ratio_view, ratio_view);
+			} else if (opt.use_eigenbasis) {
+				numerov::build_eigenbasis(blocks.potential[block], blocks.workspace[0], blocks.eigen[block]);
+
+				numerov::renormalized(mass, progress.step, energy_view, blocks.eigen[block], blocks.workspace,
+				                      prev_ratio_view, ratio_view);
+			} else if (opt.use_mixed) {
+				// NOTE: The first step is always checked, so that energies for which
+				// single precision is not enough are detected early.
+				bool is_checked = (progress.visit_count%opt.mixed_interval == 0);
+
+				Vec<f64> deviation_view(chunk.active_count - first, &chunk.deviation[block][first]);
+
+				numerov::renormalized_mixed(mass, progress.step, energy_view, blocks.potential[block], opt.mixed_tolerance,
+				                            is_checked, deviation_view, blocks.workspace, prev_ratio_view, ratio_view);
+			} else {
+				numerov::renormalized(mass, progress.step, energy_view, blocks.potential[block], blocks.workspace,
+				                      prev_ratio_view, ratio_view);
+			}
+
+			// NOTE: The coarse propagation visits every other grid point, such that
+			// the last one is also visited, as with the adaptive step.
+			if (opt.use_richardson && ((grid_count - 1 - R.index)%2 == 0)) {
+				chunk.coarse_prev_ratio[block].swap(chunk.coarse_ratio[block]);
+
+				numerov::RatioBatch coarse_prev_ratio_view(chunk.coarse_prev_ratio[block], first, chunk.active_count);
+				numerov::RatioBatch coarse_ratio_view(chunk.coarse_ratio[block], first, chunk.active_count);
+
+				if (opt.use_eigenbasis) {
+					numerov::renormalized(mass, 2.0*progress.step, energy_view, blocks.eigen[block], blocks.workspace,
+					                      coarse_prev_ratio_view, coarse_ratio_view);
+				} else {
+					numerov::renormalized(mass, 2.0*progress.step, energy_view, blocks.potential[block], blocks.workspace,
+					                      coarse_prev_ratio_view, coarse_ratio_view);
+				}
+			}
+		}
+
+		clock.stop();
+
+		// NOTE: After a doubling, the potential two old steps back is kept, since it
+		// lies one new step back, so that the three points of the next error estimate
+		// are equally spaced.
+		if (opt.use_adaptive_step) {
+			if (is_doubled == false) {
+				past_potential.swap(last_potential);
+			}
+
+			last_potential = potential;
+		}
+
+		++progress.visit_count;
+		progress.next_index = R.index + progress.multiple;
+
+		// NOTE: The ratio matrices now relate the wavefunction at R + step to that at
+		// R, thus they are matched at R, as those of the last grid point.
+		while (output.match.has_value() && (next_match < opt.match_list.count())
+		       && ((R.value + 0.5*R_list.step) > opt.match_list[next_match])) {
+			numerov::write_match_entries(output.match.value(), next_match, mass, progress.step, R.value, basis.value(),
+			                             coupling, chunk.ratio, chunk.result, chunk.count, energy_list.count(),
+			                             blocks.workspace);
+
+			if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+				print::line("# S-matrix matched at R = ", R.value, " a.u.");
+			}
+
+			++next_match;
+		}
+
+		// NOTE: Only energies started in every block are checked, which are the last
+		// active ones, from the largest first_energy on. Those converged are moved
+		// to the end of the active ones, from the last slot down.
+		if (opt.use_early_stop && (progress.visit_count%opt.convergence_interval == 0)) {
+			mut<usize> first = 0;
+
+			for (mut<usize> block = 0; block < block_count; ++block) {
+				first = std::max(first, chunk.first_energy[block]);
+			}
+
+			if (first < chunk.active_count) {
+				usize converged_count = check_convergence(mass, progress.step, R.value, opt.convergence_tolerance, basis.value(),
+				                                          coupling, chunk.ratio, chunk.result, first, chunk.active_count,
+				                                          blocks.workspace, chunk.react, chunk.has_react, chunk.is_converged);
+
+				for (mut<usize> n = chunk.active_count; n > first; --n) {
+					if (chunk.is_converged[n - 1] == 1) {
+						swap_energies(n - 1, chunk.active_count - 1, chunk);
+						--chunk.active_count;
+					}
+				}
+
+				chunk.stopped_count += converged_count;
+				chunk.skipped_point_count += converged_count*(grid_count - 1 - R.index);
+			}
+		}
+
+		if ((opt.checkpoint_interval > 0) && (progress.visit_count%opt.checkpoint_interval == 0)
+		    && (progress.next_index < grid_count)) {
+			numerov::checkpoint_filename(opt.checkpoint_prefix.as_cstr(), mpi.rank(),
+			                             (progress.visit_count/opt.checkpoint_interval)%2, checkpoint_file);
+
+			numerov::write_checkpoint(checkpoint_file.as_cstr(), mpi.world_size(), progress, energy_batch, coupling,
+			                          chunk.ratio, chunk.prev_ratio, chunk.active, past_potential, last_potential,
+			                          opt.use_adaptive_step, opt.use_pruning);
+
+			// NOTE: No process starts the next checkpoint before all others have
+			// completed this one, see restart_chunk().
+			mpi.wait();
+		}
+
+		print::line<9, '#'>(mpi.rank(), ' ', R.value, ' ', clock[0], ' ', clock[1], ' ', clock[0] + clock[1]);
+
+		if (opt.use_early_stop && (chunk.active_count == 0)) {
+			break;
+		}
+	}
+
+	return progress;
+}
+
+static void print_chunk_summary(const mpi::Frontend &mpi,
+                                const numerov::Potential &coupling,
+                                const Options &opt,
+                                usize grid_count,
+                                const numerov::Progress &progress,
+                                const Chunk &chunk)
+{
+	usize block_count = coupling.block_count();
+
+	usize count = chunk.count;
+
+	if (opt.use_adaptive_step) {
+		print::line("# MPI proc. ", mpi.rank(), ": Largest estimated step error of ", progress.max_error, " for a tolerance of ",
+		            opt.step_tolerance, ", with a final step of ", progress.step, " a.u.",
+		            (progress.is_step_fixed? ", and doublings stopped by the tolerance" : ""));
+	}
+
+	if (opt.use_mixed) {
+		mut<usize> fallback_count = 0;
+		mut<f64> max_deviation = 0.0;
+
+		for (mut<usize> block = 0; block < block_count; ++block) {
+			for (mut<usize> n = 0; n < count; ++n) {
+				fallback_count += ((chunk.deviation[block][n] > opt.mixed_tolerance)? 1 : 0);
+				max_deviation = std::max(max_deviation, chunk.deviation[block][n]);
+			}
+		}
+
+		print::line("# MPI proc. ", mpi.rank(), ": Mixed-precision deviation of ", max_deviation, ", with ", fallback_count,
+		            " of ", block_count*count, " (block, energy) pairs propagated in double precision");
+	}
+
+	if (opt.use_adaptive_start) {
+		mut<usize> skipped_count = 0;
+
+		for (mut<usize> block = 0; block < block_count; ++block) {
+			for (mut<usize> n = 0; n < count; ++n) {
+				skipped_count += chunk.start_index[block][n];
+			}
+		}
+
+		print::line("# MPI proc. ", mpi.rank(), ": Adaptive start skipped ", skipped_count, " of ", block_count*count*grid_count,
+		            " (block, energy) grid points");
+	}
+
+	if (opt.use_early_stop) {
+		print::line("# MPI proc. ", mpi.rank(), ": Early termination stopped ", chunk.stopped_count, " of ", count,
+		            " energies, skipping ", chunk.skipped_point_count, " of ", count*grid_count, " (energy, grid point) pairs");
+	}
+}
+
+static void write_chunk(const numerov::Potential &coupling,
+                        const Options &opt,
+                        f64 mass,
+                        const numerov::Progress &progress,
+                        const Range<f64> &energy_list,
+                        const std::optional<numerov::Basis> &basis,
+                        Blocks &blocks,
+                        Chunk &chunk,
+                        OutputFiles &output)
+{
+	usize channel_count = coupling.channel_count();
+
+	//
+	// Log-derivative engine: Convert the log-derivative matrices at the last grid
+	// point into the ratio matrices yielding the same reaction matrix, so that the
+	// output is the same as that of the renormalized Numerov engine.
+	//
+
+	if (opt.use_log_derivative) {
+		Mat<f64> y(channel_count, channel_count), buffer(channel_count, channel_count);
+
+		for (mut<usize> n = 0; n < chunk.count; ++n) {
+			numerov::copy_ratio(coupling, chunk.ratio, n, y);
+
+			numerov::build_ratio_matrix(mass, progress.step, progress.R_max, chunk.local_energy[n], y, basis.value(),
+			                            blocks.workspace[0], buffer);
+
+			for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+				coupling.copy_block(block, buffer, chunk.ratio[block][n]);
+			}
+		}
+	}
+
+	//
+	// Output: Write the ratio matrices of all local energies, along with their energy
+	// index and energy value, and/or their S-matrices and extrapolated reaction
+	// matrices.
+	//
+
+	Mat<f64> buffer(channel_count, channel_count);
+
+	if (output.solution.has_value()) {
+		numerov::write_ratio_entries(output.solution.value(), coupling, chunk.ratio, chunk.result, chunk.count, buffer);
+	}
+
+	if (output.smatrix.has_value()) {
+		numerov::write_smatrix_entries(output.smatrix.value(), mass, progress.step, progress.R_max, basis.value(),
+		                               coupling, chunk.ratio, chunk.result, chunk.count, chunk.active_count, chunk.react,
+		                               energy_list.count(), blocks.workspace);
+	}
+
+	if (output.richardson.has_value()) {
+		numerov::write_richardson_entries(output.richardson.value(), mass, progress.step, progress.R_max, basis.value(),
+		                                  coupling, chunk.ratio, chunk.coarse_ratio, chunk.result, chunk.count,
+		                                  blocks.workspace[0]);
+	}
+}
 
 int main(int argc, char *argv[])
 {
@@ -52,149 +1331,132 @@ int main(int argc, char *argv[])
 
 	mpi.set_tasks(energy_list.count());
 
-	usize chunk_size = mpi.task_count() + 1;
+	//
+	// Propagation options: See read_options() for all of them, and check_options()
+	// for those that cannot be combined.
+	//
+
+	Options opt;
+
+	read_options(toml, mpi, opt);
+	check_options(opt, R_list);
+
+	//
+	// Scattering basis set: Used by the log-derivative engine to convert its
+	// solutions into ratio matrices at the last grid point, by the pruning of
+	// closed channels for their asymptotic energies, and by the S- and reaction
+	// matrices.
+	//
+
+	std::optional<numerov::Basis> basis;
+
+	if (opt.use_log_derivative || opt.use_pruning || opt.use_smatrix || opt.use_match || opt.use_richardson) {
+		String filename = toml.string("fgh", "filename", "atom+diatom_fgh_basis.bin", &mpi);
+
+		basis.emplace(filename);
+
+		if (basis->list.length() != channel_count) {
+			print::error(WHERE, "The basis set in ", basis->filename.as_cstr(), " does not match the coupling matrix in ", coupling.filename());
+		}
+	}
+
+	// NOTE: The number of grid points visited by Range<f64>::indexed(), as required
+	// by the Simpson weights of the log-derivative engine.
+	mut<usize> grid_count = 0;
+
+	for ([[maybe_unused]] auto R : R_list.indexed()) {
+		++grid_count;
+	}
 
 	//
 	// Summary:
 	//
 
 	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
-		print::line();
-		print::line("# Grid size: ", R_list.count());
-		print::line("# Channel count: ", channel_count);
-		print::line("# Reduced mass: ", mass, " a.u.");
-		print::line("#");
-		print::line("# MPI proc.                  R (a.u.)                  I/O time (s)                prop. time (s)                total time (s)");
-		print::line("# --------------------------------------------------------------------------------------------------------------------------------");
+		print_summary(coupling, opt);
 	}
 
 	//
-	// Propagation of all collision energies for each R-value:
+	// Output:
 	//
 
-	Vec<Job> result(chunk_size);
-	Mat<f64> workspace(channel_count, channel_count);
-	Mat<f64> prev_ratio(channel_count, channel_count);
+	OutputFiles output;
 
-	for (auto R : R_list.indexed()) {
-		Timer<2> clock;
+	open_output_files(toml, mpi, opt, coupling, mass, R_list, energy_list, basis, output);
 
-		clock.start();
-		auto &potential = coupling[R.index];
-		clock.stop();
+	//
+	// Local energies: The n-th energy index used below (task) is relative to
+	// each MPI process, thus the job list is indexed using the count variable.
+	// With the dynamic scheduling, the master process only coordinates the others,
+	// which receive their first chunk of energies in here.
+	//
 
-		// NOTE: The n-th energy index used below (task) is relative to each
-		// MPI process, thus the job list is indexed using the count variable.
-		mut<usize> count = 0;
+	usize chunk_size = (opt.use_dynamic_schedule? numerov::chunk_length(energy_list.count(), mpi.world_size() - 1,
+	                                                                    opt.energy_chunk)
+	                                            : mpi.task_count() + 1);
 
-		clock.start();
+	Chunk chunk(chunk_size, coupling.block_count(), channel_count);
 
-		for (mut<usize> task = mpi.first_local_task(); task <= mpi.last_local_task(); ++task) {
-			extra_step:
+	if (opt.use_dynamic_schedule) {
+		if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
+			numerov::Progress progress = numerov::coordinate_chunks(mpi, R_list, energy_list, opt.energy_chunk);
 
-			if (R.index == 0) {
-				result[count].index = task;
-				result[count].energy = energy_list[task];
-				result[count].ratio.resize(channel_count, channel_count);
+			if (output.solution.has_value()) {
+				numerov::write_ratio_header(output.solution.value(), channel_count, mass, R_list, progress, energy_list);
 			}
 
-			// NOTE: When swapping the matrices, the current result ratio will
-			// hold garbage data temporarily, but the Numerov routine will only
-			// rewrite it with the updated ratio matrix. We take advantage of
-			// this write-only feature to avoid zeroing the whole matrix every
-			// step, which can become expensive.
-			prev_ratio.swap(result[count].ratio);
+			return EXIT_SUCCESS;
+		}
 
-			numerov::renormalized(mass,
-			                      R_list.step,
-			                      energy_list[task],
-			                      potential.value, workspace, prev_ratio, result[count].ratio);
-			++count;
+		mpi.send(mpi::MASTER_PROCESS_RANK, chunk.count);
 
-			if (task == mpi.last_local_task()) {
-				auto index = mpi.extra_task();
+		chunk.count = numerov::receive_chunk(mpi, energy_list, chunk.result, chunk.local_energy);
 
-				if (index.has_value()) {
-					task = index.value();
-					goto extra_step;
-				}
-			}
+		if (chunk.count == 0) {
+			return EXIT_SUCCESS;
 		}
+	} else {
+		chunk.count = static_chunk(mpi, energy_list, chunk);
+	}
 
-		clock.stop();
+	Blocks blocks;
 
-		print::line<9, '#'>(mpi.rank(), ' ', R.value, ' ', clock[0], ' ', clock[1], ' ', clock[0] + clock[1]);
-	}
+	setup_blocks(coupling, opt, mass, R_list, grid_count, energy_list, basis, blocks);
 
 	//
-	// Send all ratio matrices, their energy index, and energy value to the master process:
+	// Propagation of all collision energies for each R-value, one chunk of energies
+	// at a time. With the static scheduling, there is a single chunk. Otherwise, the
+	// master process is told when a chunk is done, and replies with the next one,
+	// if any.
 	//
 
-	usize extra_task = chunk_size - 1;
+	numerov::Progress progress = {0, 0, 1, R_list.step, R_list.min, 0.0, false};
 
-	if (mpi.rank() == mpi::MASTER_PROCESS_RANK) {
-		file::Output solution = toml.output_filename("numerov", "numerov_ratio_matrix.bin");
+	mut<bool> has_chunk = true;
 
-		solution.write(numerov::MAGIC_NUMBER);
-		solution.write(FORMAT_VERSION);
-		solution.write(channel_count);
-		solution.write(mass);
-		solution.write(R_list);
-		solution.write(energy_list);
+	while (has_chunk) {
+		setup_chunk(coupling, opt, blocks, chunk);
 
-		for (mut<usize> task = 0; task < extra_task; ++task) {
-			solution.write(result[task].index);
-			solution.write(result[task].energy);
-			solution.write(result[task].ratio);
-		}
+		progress = propagate_chunk(mpi, coupling, opt, mass, R_list, grid_count, energy_list, basis, blocks, chunk,
+		                           output);
 
-		for (mut<u32> rank = 1; rank < mpi.world_size(); ++rank) {
-			for (mut<usize> task = 0; task < extra_task; ++task) {
-				mpi.receive(rank, result[task].index);
-				mpi.receive(rank, result[task].energy);
-				mpi.receive(rank, result[task].ratio);
+		print_chunk_summary(mpi, coupling, opt, grid_count, progress, chunk);
 
-			 	solution.write(result[task].index);
-			 	solution.write(result[task].energy);
-			 	solution.write(result[task].ratio);
-			}
-		}
+		write_chunk(coupling, opt, mass, progress, energy_list, basis, blocks, chunk, output);
 
-		if (result[extra_task].index > 0) {
-			solution.write(result[extra_task].index);
-			solution.write(result[extra_task].energy);
-			solution.write(result[extra_task].ratio);
-		}
+		has_chunk = false;
 
-		for (mut<u32> rank = 1; rank < mpi.world_size(); ++rank) {
-			mpi.receive(rank, result[extra_task].index);
+		if (opt.use_dynamic_schedule) {
+			numerov::send_chunk(mpi, chunk.count, progress);
 
-			if (result[extra_task].index > 0) {
-				mpi.receive(rank, result[extra_task].energy);
-				mpi.receive(rank, result[extra_task].ratio);
+			chunk.count = numerov::receive_chunk(mpi, energy_list, chunk.result, chunk.local_energy);
 
-				solution.write(result[extra_task].index);
-				solution.write(result[extra_task].energy);
-				solution.write(result[extra_task].ratio);
-			}
-		}
-	} else {
-		for (mut<usize> task = 0; task < extra_task; ++task) {
-			mpi.send(mpi::MASTER_PROCESS_RANK, result[task].index);
-			mpi.send(mpi::MASTER_PROCESS_RANK, result[task].energy);
-			mpi.send(mpi::MASTER_PROCESS_RANK, result[task].ratio);
+			has_chunk = (chunk.count > 0);
 		}
+	}
 
-		// NOTE: If the extra task is unused, its index is set to zero,
-		// which is invalid, and will let the master process know that
-		// it is to be skipped. In these cases the ratio matrix is not
-		// allocated either.
-		mpi.send(mpi::MASTER_PROCESS_RANK, result[extra_task].index);
-
-		if (result[extra_task].index > 0) {
-			mpi.send(mpi::MASTER_PROCESS_RANK, result[extra_task].energy);
-			mpi.send(mpi::MASTER_PROCESS_RANK, result[extra_task].ratio);
-		}
+	if (output.solution.has_value() && (mpi.rank() == mpi::MASTER_PROCESS_RANK)) {
+		numerov::write_ratio_header(output.solution.value(), channel_count, mass, R_list, progress, energy_list);
 	}
 
 	return EXIT_SUCCESS;
@@ -5,13 +5,6 @@
 constexpr u8 PAD = 24;
 constexpr u8 FORMAT_VERSION = 3;
 
-struct Job {
-	Mat<f64> k;
-	Mat<f64> re_s;
-	Mat<f64> im_s;
-	mut<f64> total_energy;
-};
-
 int main(int argc, char *argv[])
 {
 	print::line("# ", argv[0]);
@@ -36,6 +29,8 @@ int main(int argc, char *argv[])
 
 	const Range<f64> R_list = solution.grid_range();
 
+	f64 R_match = solution.match_radius();
+
 	usize channel_count = solution.channel_count();
 
 	f64 mass = solution.reduced_mass();
@@ -64,43 +59,45 @@ int main(int argc, char *argv[])
 	print::line();
 	print::line("# Channel count: ", channel_count);
 	print::line("# Energy count: ", energy_count);
-	print::line("# R value: ", R_list.max - R_list.step);
+	print::line("# R value: ", R_match);
 	print::line("# Reduced mass: ", mass, " a.u.");
 	print::line("# NOTE: grep -A ", energy_count + 1, " \"# (Ch. = $1,\" $filename | grep -A ", energy_count + 1, " \"> (Ch. = $2,\"");
 	print::line("#");
 
 	//
-	// Compute the augmented K-matrix and S-matrix for every energy.
+	// Compute the augmented K-matrix and S-matrix for every energy, matched at the
+	// last grid point of the propagation, as recorded in the ratio file. The full
+	// matrices are kept, with zeros in the S-matrix for closed channels, thus the
+	// open ones need not be the first channels of the basis set.
 	//
 
-	Vec<Job> list(energy_count);
+	numerov::RatioBatch ratio(channel_count, energy_count);
+
+	Vec<f64> energy(energy_count);
 
 	for (mut<usize> task = 0; task < energy_count; ++task) {
-		// NOTE: As of now, the Numerov driver only writes the energy-dependent
-		// ratio matrices at the final R value.
-		auto &ratio = solution(0, task);
+		auto &entry = solution(task);
 
-		Mat<f64> k(channel_count, channel_count);
+		ratio[task] = entry.value;
+		energy[task] = entry.energy;
+	}
 
-		usize open_count = numerov::build_react_matrix(mass,
-		                                               R_list.step,
-		                                               R_list.max,
-		                                               ratio.energy,
-		                                               ratio.value, basis, k);
+	u32 workspace_count = max_thread_count();
 
-		Mat<f64> re_s(open_count, open_count), im_s(open_count, open_count);
+	Vec<numerov::Workspace> workspace(workspace_count);
 
-		if (open_count > 0) {
-			k.resize(open_count, open_count);
-			numerov::build_scatt_matrix(k, re_s, im_s);
-		}
-
-		list[task].k.swap(k);
-		list[task].re_s.swap(re_s);
-		list[task].im_s.swap(im_s);
-		list[task].total_energy = ratio.energy;
+	for (mut<u32> thread = 0; thread < workspace_count; ++thread) {
+		numerov::Workspace thread_workspace(channel_count);
+		workspace[thread].swap(thread_workspace);
 	}
 
+	numerov::RatioBatch k(channel_count, energy_count);
+	numerov::RatioBatch re_s(channel_count, energy_count), im_s(channel_count, energy_count);
+
+	numerov::build_react_matrix(mass, R_list.step, R_match, energy, ratio, basis, workspace, k);
+
+	numerov::build_scatt_matrix(energy, k, basis, workspace, re_s, im_s);
+
 	//
 	// Sort the result per a-->b transitions and print as a function of energy.
 	//
@@ -145,17 +142,17 @@ int main(int argc, char *argv[])
 			f64 eigenval_b = (basis.list[channel_b].eigenval + shift)*scale;
 
 			for (mut<usize> task = 0; task < energy_count; ++task) {
-				f64 total_energy = (list[task].total_energy + shift)*scale;
+				f64 total_energy = (energy[task] + shift)*scale;
 
 				// NOTE: (x1 usize, 8 bytes) + (x3 f64, 24 bytes).
 				// For each chunk of 88 bytes, we add more energy_count*32 bytes.
 
 				smatrix.write(task);
-				smatrix.write(list[task].total_energy);
+				smatrix.write(energy[task]);
 
 				if ((total_energy > eigenval_a) && (total_energy > eigenval_b)) {
-					smatrix.write(list[task].re_s(channel_a, channel_b));
-					smatrix.write(list[task].im_s(channel_a, channel_b));
+					smatrix.write(re_s[task](channel_a, channel_b));
+					smatrix.write(im_s[task](channel_a, channel_b));
 				} else {
 					smatrix.write(0.0);
 					smatrix.write(0.0);
@@ -187,25 +184,25 @@ int main(int argc, char *argv[])
 					print::line<PAD, '#'>("Coll. energy", "Tot. energy", "k (a.u.)", "k' (a.u.)", "|S|^2", "re(S)", "im(S)", "K (open-open block)");
 				}
 
-				f64 k = list[task].k(channel_a, channel_b);
+				f64 k_ab = k[task](channel_a, channel_b);
 
 				c64 s = c64(
-					list[task].re_s(channel_a, channel_b),
-					list[task].im_s(channel_a, channel_b)
+					re_s[task](channel_a, channel_b),
+					im_s[task](channel_a, channel_b)
 				);
 
 				c64 ss = std::conj(s)*s;
 
 				f64 wavenum_a = numerov::wavenumber(mass,
-				                                    list[task].total_energy,
+				                                    energy[task],
 				                                    basis.list[channel_a].eigenval);
 
 				f64 wavenum_b = numerov::wavenumber(mass,
-				                                    list[task].total_energy,
+				                                    energy[task],
 				                                    basis.list[channel_b].eigenval);
 
 				print::line<PAD>(total_energy - eigenval_a, total_energy,
-				                 wavenum_a, wavenum_b, ss.real(), s.real(), s.imag(), k);
+				                 wavenum_a, wavenum_b, ss.real(), s.real(), s.imag(), k_ab);
 			}
 
 			print::line();
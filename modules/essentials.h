@@ -34,6 +34,18 @@ static inline u32 thread_count()
 	#endif
 }
 
+[[maybe_unused]]
+static inline u32 max_thread_count()
+{
+	#if defined(_OPENMP)
+		// NOTE: The number of threads of the next parallel region, which
+		// is meant to be called from outside of one.
+		return as_u32(omp_get_max_threads());
+	#else
+		return 1u;
+	#endif
+}
+
 [[maybe_unused]]
 static inline u32 thread_id()
 {
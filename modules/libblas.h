@@ -30,6 +30,16 @@ namespace blas {
 
 	static constexpr blas::Backend BACKEND = BLAS_BACKEND_NAME;
 
+	static inline void set_local_thread_count([[maybe_unused]] u32 count)
+	{
+		// NOTE: Sets the number of threads used by the BLAS/LAPACK calls of the calling
+		// thread only, e.g., from inside an OpenMP parallel region, where zero restores
+		// the global setting. Among the supported backends, only MKL is multithreaded.
+		#if defined(USE_MKL)
+			mkl_set_num_threads_local(as_s32(count));
+		#endif
+	}
+
 	static CBLAS_TRANSPOSE backend_transpose_enum(const char op)
 	{
 		switch (op) {
@@ -145,21 +155,15 @@ namespace blas {
 		usize n = c.cols();
 		usize k = (not_a? a.cols() : a.rows());
 
-		usize lda = (not_a? m : k);
-		usize ldb = (not_b? k : n);
-		usize ldc = m;
+		// NOTE: Matrices are stored in row-major order (see CblasRowMajor above), thus
+		// the leading dimensions are their column counts.
+		usize lda = a.cols();
+		usize ldb = b.cols();
+		usize ldc = c.cols();
 
-		if (not_a) {
-			assert(a.length() >= lda*k);
-		} else {
-			assert(a.length() >= lda*m);
-		}
-
-		if (not_b) {
-			assert(b.length() >= ldb*n);
-		} else {
-			assert(b.length() >= ldb*k);
-		}
+		assert((not_a? a.rows() : a.cols()) == m);
+		assert((not_b? b.rows() : b.cols()) == k);
+		assert((not_b? b.cols() : b.rows()) == n);
 
 		blas::gemm(transa, transb, m, n, k,
 		           &a[0], lda, &b[0], ldb, &c[0], ldc, alpha, beta);
@@ -121,6 +121,82 @@ namespace lapack {
 		lapack::syev('v', 'l', n, &eigenvec[0], &eigenval[0]);
 	}
 
+	template<typename T>
+	static usize syev_work_length(usize n)
+	{
+		// NOTE: Optimal length of the work array used by lapack::syev() below, as
+		// queried from the backend.
+
+		mut<usize> length = 3*n;
+
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			mut<T> query = 0.0;
+
+			s32 lda = as_s32(n);
+
+			if constexpr(is_f32<T>()) {
+				auto info = LAPACKE_ssyev_work(LAPACK_COL_MAJOR, 'v', 'u', lda, nullptr, lda, nullptr, &query, -1);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssyev_work()", info)
+			} else if constexpr(is_f64<T>()) {
+				auto info = LAPACKE_dsyev_work(LAPACK_COL_MAJOR, 'v', 'u', lda, nullptr, lda, nullptr, &query, -1);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsyev_work()", info)
+			} else {
+				print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64");
+			}
+
+			if (as_usize(query) > length) {
+				length = as_usize(query);
+			}
+		#endif
+
+		return length;
+	}
+
+	template<typename T>
+	static void syev(Mat<T> &eigenvec, Vec<T> &eigenval, Vec<T> &work)
+	{
+		// NOTE: Same as above, but with a work array provided by the caller, of at
+		// least lapack::syev_work_length() elements. The column-major interface of
+		// LAPACKE is used, which allocates no memory, since the lower triangle of a
+		// symmetric matrix in row-major order is its upper one in column-major order.
+		// The eigenvectors are then transposed to be stored in columns on exit.
+
+		usize n = eigenvec.rows();
+
+		assert(eigenvec.cols() == n);
+		assert(eigenval.length() == n);
+
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			#if defined(USE_MKL)
+				LAPACKE_set_nancheck(0);
+			#endif
+
+			s32 lda = as_s32(n);
+			s32 lwork = as_s32(work.length());
+
+			if constexpr(is_f32<T>()) {
+				auto info = LAPACKE_ssyev_work(LAPACK_COL_MAJOR, 'v', 'u', lda, &eigenvec[0], lda, &eigenval[0], &work[0], lwork);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssyev_work()", info)
+			} else if constexpr(is_f64<T>()) {
+				auto info = LAPACKE_dsyev_work(LAPACK_COL_MAJOR, 'v', 'u', lda, &eigenvec[0], lda, &eigenval[0], &work[0], lwork);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsyev_work()", info)
+			} else {
+				print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64");
+			}
+
+			for (mut<usize> row = 0; row < n; ++row) {
+				for (mut<usize> col = (row + 1); col < n; ++col) {
+					T value = eigenvec(row, col);
+
+					eigenvec(row, col) = eigenvec(col, row);
+					eigenvec(col, row) = value;
+				}
+			}
+		#else
+			lapack::syev(eigenvec, eigenval);
+		#endif
+	}
+
 	template<typename T>
 	static void sytri(const char uplo, usize n, T a[], mut<s32> ipiv[])
 	{
@@ -227,6 +303,213 @@ namespace lapack {
 		lapack::sytri(a, ipiv);
 	}
 
+	template<typename T>
+	static usize sytri_work_length(usize n)
+	{
+		// NOTE: Optimal length of the work array used by lapack::sytri() below, as
+		// queried from the backend for ?sytrf, and at least 2n as for ?sytri.
+
+		mut<usize> length = 2*n;
+
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			mut<T> query = 0.0;
+
+			s32 lda = as_s32(n);
+
+			if constexpr(is_f32<T>()) {
+				auto info = LAPACKE_ssytrf_work(LAPACK_COL_MAJOR, 'l', lda, nullptr, lda, nullptr, &query, -1);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssytrf_work()", info)
+			} else if constexpr(is_f64<T>()) {
+				auto info = LAPACKE_dsytrf_work(LAPACK_COL_MAJOR, 'l', lda, nullptr, lda, nullptr, &query, -1);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsytrf_work()", info)
+			} else {
+				print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64");
+			}
+
+			if (as_usize(query) > length) {
+				length = as_usize(query);
+			}
+		#endif
+
+		return length;
+	}
+
+	template<typename T>
+	static void sytri(Mat<T> &a, Vec<s32> &ipiv, Vec<T> &work)
+	{
+		// NOTE: Same as above, but with a work array provided by the caller, of at
+		// least lapack::sytri_work_length() elements. The column-major interface of
+		// LAPACKE is used, which allocates no memory, since the upper triangle of a
+		// symmetric matrix in row-major order is its lower one in column-major order.
+
+		usize n = a.rows();
+
+		assert(a.cols() == n);
+		assert(ipiv.length() == n);
+
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			#if defined(USE_MKL)
+				LAPACKE_set_nancheck(0);
+			#endif
+
+			auto ipiv_ptr = static_cast<lapack_int*>(&ipiv[0]);
+
+			s32 lda = as_s32(n);
+			s32 lwork = as_s32(work.length());
+
+			if constexpr(is_f32<T>()) {
+				auto info = LAPACKE_ssytrf_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0], lwork);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssytrf_work()", info)
+
+				info = LAPACKE_ssytri_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0]);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssytri_work()", info)
+			} else if constexpr(is_f64<T>()) {
+				auto info = LAPACKE_dsytrf_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0], lwork);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsytrf_work()", info)
+
+				info = LAPACKE_dsytri_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0]);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsytri_work()", info)
+			} else {
+				print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64");
+			}
+
+			for (mut<usize> row = 0; row < n; ++row) {
+				for (mut<usize> col = (row + 1); col < n; ++col) {
+					a(col, row) = a(row, col);
+				}
+			}
+		#else
+			lapack::sytri(a, ipiv);
+		#endif
+	}
+
+	template<typename T>
+	static usize sytrf(Mat<T> &a, Vec<s32> &ipiv, Vec<T> &work)
+	{
+		// NOTE: Computes the symmetric (LDL') factorization of a in place, using the
+		// same column-major interface and work array as lapack::sytri() above, and
+		// returns the number of negative eigenvalues of a. By Sylvester's law of
+		// inertia, these are the negative eigenvalues of the block diagonal D, made
+		// of 1-by-1 and 2-by-2 blocks as indicated by the signs of ipiv. The factor
+		// can be inverted afterwards by lapack::sytri_factored().
+
+		usize n = a.rows();
+
+		assert(a.cols() == n);
+		assert(ipiv.length() == n);
+
+		mut<usize> negative_count = 0;
+
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			#if defined(USE_MKL)
+				LAPACKE_set_nancheck(0);
+			#endif
+
+			auto ipiv_ptr = static_cast<lapack_int*>(&ipiv[0]);
+
+			s32 lda = as_s32(n);
+			s32 lwork = as_s32(work.length());
+
+			if constexpr(is_f32<T>()) {
+				auto info = LAPACKE_ssytrf_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0], lwork);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssytrf_work()", info)
+			} else if constexpr(is_f64<T>()) {
+				auto info = LAPACKE_dsytrf_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0], lwork);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsytrf_work()", info)
+			} else {
+				print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64");
+			}
+
+			// NOTE: The lower triangle in column-major order is the upper one in
+			// row-major order, thus the off-diagonal of a 2-by-2 block of D starting
+			// at k is a(k, k + 1).
+
+			mut<usize> k = 0;
+
+			while (k < n) {
+				if (ipiv[k] > 0) {
+					if (a(k, k) < 0.0) {
+						negative_count += 1;
+					}
+
+					k += 1;
+				} else {
+					f64 det = a(k, k)*a(k + 1, k + 1) - a(k, k + 1)*a(k, k + 1);
+
+					if (det < 0.0) {
+						negative_count += 1;
+					} else if ((a(k, k) + a(k + 1, k + 1)) < 0.0) {
+						negative_count += 2;
+					}
+
+					k += 2;
+				}
+			}
+		#else
+			// NOTE: The GSL backend has no symmetric factorization. Thus, the eigenvalues
+			// of a copy are computed instead, and a is left as is for the LU-based inverse
+			// of lapack::sytri_factored().
+
+			static_assert(is_f64<T>(), "Only T = f64 is possible when GSL is used as backend");
+
+			Vec<f64> a_copy(n*n), eigenval(n);
+
+			for (mut<usize> m = 0; m < a_copy.length(); ++m) {
+				a_copy[m] = a[m];
+			}
+
+			lapack::syev('n', 'l', n, &a_copy[0], &eigenval[0]);
+
+			for (mut<usize> m = 0; m < n; ++m) {
+				if (eigenval[m] < 0.0) {
+					negative_count += 1;
+				}
+			}
+		#endif
+
+		return negative_count;
+	}
+
+	template<typename T>
+	static void sytri_factored(Mat<T> &a, Vec<s32> &ipiv, Vec<T> &work)
+	{
+		// NOTE: Same as lapack::sytri() above, but with a and ipiv as factorized by
+		// lapack::sytrf().
+
+		usize n = a.rows();
+
+		assert(a.cols() == n);
+		assert(ipiv.length() == n);
+
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			#if defined(USE_MKL)
+				LAPACKE_set_nancheck(0);
+			#endif
+
+			auto ipiv_ptr = static_cast<lapack_int*>(&ipiv[0]);
+
+			s32 lda = as_s32(n);
+
+			if constexpr(is_f32<T>()) {
+				auto info = LAPACKE_ssytri_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0]);
+				CHECK_LAPACKE_ERROR("LAPACKE_ssytri_work()", info)
+			} else if constexpr(is_f64<T>()) {
+				auto info = LAPACKE_dsytri_work(LAPACK_COL_MAJOR, 'l', lda, &a[0], lda, ipiv_ptr, &work[0]);
+				CHECK_LAPACKE_ERROR("LAPACKE_dsytri_work()", info)
+			} else {
+				print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64");
+			}
+
+			for (mut<usize> row = 0; row < n; ++row) {
+				for (mut<usize> col = (row + 1); col < n; ++col) {
+					a(col, row) = a(row, col);
+				}
+			}
+		#else
+			lapack::sytri(a, ipiv);
+		#endif
+	}
+
 	template<typename T>
 	static void gesv(usize n, usize nrhs, T a[], mut<s32> ipiv[], T b[])
 	{
@@ -278,6 +561,61 @@ namespace lapack {
 		assert(b.rows() == n);
 		assert(ipiv.length() == n);
 
+		#if defined(USE_MKL) || defined(USE_LAPACKE)
+			if (nrhs == n) {
+				// NOTE: The row-major interface of LAPACKE allocates transposed copies
+				// of A and B. When B is square, both are transposed in place instead,
+				// and the column-major interface is used, which allocates no memory.
+				// On exit, A holds its transposed LU factors.
+
+				for (mut<usize> row = 0; row < n; ++row) {
+					for (mut<usize> col = (row + 1); col < n; ++col) {
+						T value_a = a(row, col);
+						T value_b = b(row, col);
+
+						a(row, col) = a(col, row);
+						a(col, row) = value_a;
+
+						b(row, col) = b(col, row);
+						b(col, row) = value_b;
+					}
+				}
+
+				#if defined(USE_MKL)
+					LAPACKE_set_nancheck(0);
+				#endif
+
+				s32 lda = as_s32(n);
+
+				if constexpr(is_f32<T>()) {
+					auto info = LAPACKE_sgesv_work(LAPACK_COL_MAJOR, lda, lda, &a[0], lda, &ipiv[0], &b[0], lda);
+					CHECK_LAPACKE_ERROR("LAPACKE_sgesv_work()", info)
+				} else if constexpr(is_f64<T>()) {
+					auto info = LAPACKE_dgesv_work(LAPACK_COL_MAJOR, lda, lda, &a[0], lda, &ipiv[0], &b[0], lda);
+					CHECK_LAPACKE_ERROR("LAPACKE_dgesv_work()", info)
+				} else if constexpr(is_c32<T>()) {
+					auto info = LAPACKE_cgesv_work(LAPACK_COL_MAJOR, lda, lda, &a[0], lda, &ipiv[0], &b[0], lda);
+					CHECK_LAPACKE_ERROR("LAPACKE_cgesv_work()", info)
+				} else if constexpr(is_c64<T>()) {
+					auto info = LAPACKE_zgesv_work(LAPACK_COL_MAJOR, lda, lda, &a[0], lda, &ipiv[0], &b[0], lda);
+					CHECK_LAPACKE_ERROR("LAPACKE_zgesv_work()", info)
+				} else {
+					print::error(WHERE, "Invalid generic type T = ", type_name<T>(), "; expected T = f32 or f64 or c32 or c64");
+				}
+
+				for (mut<usize> row = 0; row < n; ++row) {
+					for (mut<usize> col = (row + 1); col < n; ++col) {
+						T value_b = b(row, col);
+
+						b(row, col) = b(col, row);
+						b(col, row) = value_b;
+					}
+				}
+
+				return;
+			}
+		#endif
+
 		lapack::gesv(n, nrhs, &a[0], &ipiv[0], &b[0]);
 	}
 
@@ -4,6 +4,10 @@
 	#include "mpi.h"
 #endif
 
+#if !defined(USE_MPI)
+	#include <fcntl.h>
+#endif
+
 #if defined(USE_PETSC)
 	#include <petscvec.h>
 	#include <petscmat.h>
@@ -725,6 +729,16 @@ FRONTEND_RECEIVE_IMPL(f128)
   CHECK_MPI_ERROR("MPI_Bcast()", info)                                       \
 }
 
+void mpi::Frontend::broadcast([[maybe_unused]] u32 rank,
+                              [[maybe_unused]] u32 count,
+                              [[maybe_unused]] mut<bool> data[]) const
+{
+	#if defined(USE_MPI)
+		#pragma omp critical
+		CALL_MPI_BROADCAST(rank, count, data, MPI_CXX_BOOL)
+	#endif
+}
+
 void mpi::Frontend::broadcast([[maybe_unused]] u32 rank,
                               [[maybe_unused]] u32 count,
                               [[maybe_unused]] mut<u8> data[]) const
@@ -1080,6 +1094,30 @@ void mpi::Frontend::wait() const
 	#endif
 }
 
+u32 mpi::Frontend::probe() const
+{
+	// NOTE: Blocks until a message from any process is pending and returns its rank,
+	// so that the message can be received with the usual calls. Without MPI, there
+	// is no other process, and the master rank is returned.
+
+	mut<s32> source = as_s32(mpi::MASTER_PROCESS_RANK);
+
+	#if defined(USE_MPI)
+		MPI_Status status;
+
+		#pragma omp critical
+		{
+			auto info = MPI_Probe(MPI_ANY_SOURCE, MESSAGE_COUNT_TAG, MPI_COMM_WORLD, &status);
+
+			CHECK_MPI_ERROR("MPI_Probe()", info)
+		}
+
+		source = status.MPI_SOURCE;
+	#endif
+
+	return as_u32(source);
+}
+
 mpi::Frontend::~Frontend()
 {
 	this->wait();
@@ -1104,3 +1142,104 @@ mpi::Frontend::~Frontend()
 		}
 	#endif
 }
+
+//
+// Files:
+//
+
+mpi::File::File(c_str filename): filename(filename), offset(0), length(0), buffer(), handle(-1)
+{
+	// NOTE: Opened with MPI_COMM_SELF, as processes write at different times and
+	// some may finish (and close the file) long before others. Their writes never
+	// overlap, and all are complete once every process has closed the file.
+
+	#if defined(USE_MPI)
+		mut<s32> info = 0;
+
+		MPI_File file;
+
+		#pragma omp critical
+		info = MPI_File_open(MPI_COMM_SELF, this->filename.as_cstr(), MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+
+		if (info != MPI_SUCCESS) {
+			print::error(WHERE, "MPI_File_open() failed with error code ", info, " for ", this->filename.as_cstr());
+		}
+
+		this->handle = as_s32(MPI_File_c2f(file));
+	#else
+		this->handle = open(this->filename.as_cstr(), O_WRONLY);
+
+		if (this->handle == -1) {
+			print::error(WHERE, "Unable to open ", this->filename.as_cstr(), " for writing");
+		}
+	#endif
+}
+
+void mpi::File::seek_set(usize count)
+{
+	if (count == (this->offset + this->length)) {
+		return;
+	}
+
+	this->flush();
+	this->offset = count;
+}
+
+void mpi::File::flush()
+{
+	mut<usize> written = 0;
+
+	while (written < this->length) {
+		// NOTE: MPI specifies the count of elements with an int.
+		usize count = std::min(this->length - written, as_usize(INT_MAX));
+
+		#if defined(USE_MPI)
+			mut<s32> info = 0;
+
+			MPI_Status status;
+
+			MPI_File file = MPI_File_f2c(this->handle);
+
+			#pragma omp critical
+			info = MPI_File_write_at(file, static_cast<MPI_Offset>(this->offset + written), &this->buffer[written],
+			                         as_s32(count), MPI_BYTE, &status);
+
+			if (info != MPI_SUCCESS) {
+				print::error(WHERE, "MPI_File_write_at() failed with error code ", info, " for ", this->filename.as_cstr());
+			}
+
+			written += count;
+		#else
+			auto info = pwrite(this->handle, &this->buffer[written], count, static_cast<off_t>(this->offset + written));
+
+			if (info <= 0) {
+				print::error(WHERE, "Only ", written, "/", this->length, " bytes written to ", this->filename.as_cstr());
+			}
+
+			written += as_usize(info);
+		#endif
+	}
+
+	this->offset += this->length;
+	this->length = 0;
+}
+
+mpi::File::~File()
+{
+	this->flush();
+
+	#if defined(USE_MPI)
+		mut<s32> info = 0;
+
+		MPI_File file = MPI_File_f2c(this->handle);
+
+		#pragma omp critical
+		info = MPI_File_close(&file);
+
+		if (info != MPI_SUCCESS) {
+			print::error(WHERE, "MPI_File_close() failed with error code ", info, " for ", this->filename.as_cstr());
+		}
+	#else
+		close(this->handle);
+	#endif
+}
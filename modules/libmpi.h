@@ -358,6 +358,8 @@ namespace mpi {
 		// they are used herein with the same group communicator and, therefore,
 		// are also bound to OpenMP critical regions.
 
+		void broadcast(u32 rank, u32 count, mut<bool> data[]) const;
+
 		void broadcast(u32 rank, u32 count, mut<u8> data[]) const;
 
 		void broadcast(u32 rank, u32 count, mut<u16> data[]) const;
@@ -466,6 +468,8 @@ namespace mpi {
 
 		void wait() const;
 
+		u32 probe() const;
+
 		template<u8 PAD, usize LEN>
 		void print_line(const print::Fmt<PAD, LEN> &content)
 		{
@@ -516,4 +520,104 @@ namespace mpi {
 		mut<s32> comm_size;
 		mut<usize> total_tasks;
 	};
+
+	// NOTE: An existing file opened for writing by the calling process alone, without
+	// being truncated, so that every process writes its own parts of a shared file
+	// at given positions (see seek_set()). Contiguous writes are gathered in memory
+	// and issued at once with MPI_File_write_at(), or pwrite() if MPI is not used,
+	// thus never through the stdio buffers, which are unsafe for concurrent writers
+	// on filesystems caching the file in each node, such as NFS.
+	class File {
+		public:
+		const String filename;
+
+		File(c_str filename);
+
+		File(const File &other) = delete;
+
+		template<typename T>
+		void write_raw(usize count, const T *data)
+		{
+			assert(data != nullptr);
+
+			usize size = sizeof(T)*count;
+
+			if (this->buffer.length() < (this->length + size)) {
+				this->buffer.resize(2*(this->length + size));
+			}
+
+			std::memcpy(&this->buffer[this->length], &data[0], size);
+
+			this->length += size;
+		}
+
+		inline void write(u8 data)
+		{
+			this->write_raw<u8>(1, &data);
+		}
+
+		inline void write(u16 data)
+		{
+			this->write_raw<u16>(1, &data);
+		}
+
+		inline void write(u32 data)
+		{
+			this->write_raw<u32>(1, &data);
+		}
+
+		inline void write(u64 data)
+		{
+			this->write_raw<u64>(1, &data);
+		}
+
+		inline void write(s32 data)
+		{
+			this->write_raw<s32>(1, &data);
+		}
+
+		inline void write(f64 data)
+		{
+			this->write_raw<f64>(1, &data);
+		}
+
+		inline void write(const Vec<u64> &data)
+		{
+			this->write_raw<mut<u64>>(data.length(), &data[0]);
+		}
+
+		inline void write(const Vec<f64> &data)
+		{
+			this->write_raw<mut<f64>>(data.length(), &data[0]);
+		}
+
+		inline void write(const Mat<f64> &data)
+		{
+			this->write_raw<mut<f64>>(data.rows()*data.cols(), &data[0]);
+		}
+
+		inline void write(const Range<f64> &data)
+		{
+			f64 list[] = {data.min, data.max, data.step};
+			this->write_raw<f64>(3, list);
+		}
+
+		// NOTE: Data written so far is sent to the file only when writing elsewhere,
+		// on flush(), or when the file is closed.
+		void seek_set(usize count = 0);
+
+		void flush();
+
+		~File();
+
+		private:
+		mut<usize> offset;
+		mut<usize> length;
+		Vec<byte> buffer;
+
+		// NOTE: The Fortran handle of the MPI file (see MPI_File_c2f()), or the file
+		// descriptor if MPI is not used. An integer either way, so that no MPI type
+		// leaks into this header, which drivers include without USE_MPI.
+		mut<s32> handle;
+	};
 }
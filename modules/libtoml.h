@@ -414,6 +414,14 @@ namespace toml {
 				goto meeting_point;
 			}
 
+			if constexpr(::is_bool<T>()) {
+				if (node.type() != toml::node_type::boolean) {
+					print::error(WHERE, "Expecting a boolean value at ", block0);
+				}
+
+				entry = node.ref<bool>();
+			}
+
 			if constexpr(::is_integer<T>()) {
 				if (node.type() != toml::node_type::integer) {
 					print::error(WHERE, "Expecting an integer value at ", block0);
@@ -457,6 +465,14 @@ namespace toml {
 				goto meeting_point;
 			}
 
+			if constexpr(::is_bool<T>()) {
+				if (node.type() != toml::node_type::boolean) {
+					print::error(WHERE, "Expecting a boolean value at ", block0, '.', block1);
+				}
+
+				entry = node.ref<bool>();
+			}
+
 			if constexpr(::is_integer<T>()) {
 				if (node.type() != toml::node_type::integer) {
 					print::error(WHERE, "Expecting an integer value at ", block0, '.', block1);
@@ -500,6 +516,14 @@ namespace toml {
 				goto meeting_point;
 			}
 
+			if constexpr(::is_bool<T>()) {
+				if (node.type() != toml::node_type::boolean) {
+					print::error(WHERE, "Expecting a boolean value at ", block0, '.', block1, '.', block2);
+				}
+
+				entry = node.ref<bool>();
+			}
+
 			if constexpr(::is_integer<T>()) {
 				if (node.type() != toml::node_type::integer) {
 					print::error(WHERE, "Expecting an integer value at ", block0, '.', block1, '.', block2);
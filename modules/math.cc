@@ -545,6 +545,35 @@ MATH_SIMPSON_IMPL3(c128)
 
 #undef MATH_SIMPSON_IMPL3
 
+void math::simpson_weights(f64 step, Vec<f64> &weight)
+{
+	// NOTE: The weights of math::simpson() for integrands of the given length, with
+	// the same points left out, such that the integral is the sum of weight[n] times
+	// integrand[n], e.g., for integrals of many integrands on the same grid at once.
+
+	f64 fact = 3.0*step/8.0;
+
+	mut<usize> n_max = weight.length() - 1;
+
+	while (n_max%3 != 0) {
+		--n_max;
+	}
+
+	assert(n_max > 2);
+
+	weight = 0.0;
+	weight[0] = fact;
+
+	for (mut<usize> n = 1; n < (n_max - 3); n += 3) {
+		weight[n + 0] = 3.0*fact;
+		weight[n + 1] = 3.0*fact;
+		weight[n + 2] = 2.0*fact;
+	}
+
+	weight[n_max - 1] = 3.0*fact;
+	weight[n_max] = fact;
+}
+
 static constexpr f128 gauss_legendre_weight_2nd[] = {
 	1.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000,
 	1.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000
@@ -5247,3 +5276,26 @@ f64 math::gauss_legendre(f64 a, f64 b, u8 order, void *params, math::integrand f
 
 	return ab_sub*sum;
 }
+
+void math::gauss_legendre(f64 a, f64 b, u8 order, Vec<f64> &node, Vec<f64> &weight)
+{
+	// NOTE: The nodes and weights of the quadrature above, such that the integral
+	// of f from a to b is the sum of weight[n]*f(node[n]), for routines evaluating
+	// several integrands on the same nodes.
+
+	assert(order > 1);
+	assert(order < 65);
+	assert(node.length() == order);
+	assert(weight.length() == order);
+
+	f64 ab_sum = (b + a)/2.0;
+	f64 ab_sub = (b - a)/2.0;
+
+	f128 *x = gauss_legendre_root(order);
+	f128 *w = gauss_legendre_weight(order);
+
+	for (mut<u8> n = 0; n < order; ++n) {
+		node[n] = ab_sub*as_f64(x[n]) + ab_sum;
+		weight[n] = ab_sub*as_f64(w[n]);
+	}
+}
@@ -231,6 +231,8 @@ namespace math {
 	            const Vec<f64> &integrand_b,
 	            const Vec<f64> &integrand_c);
 
+	void simpson_weights(f64 step, Vec<f64> &weight);
+
 	f128 simpson(f128 step,
 	             const Vec<f128> &integrand_a,
 	             const Vec<f128> &integrand_b,
@@ -253,6 +255,8 @@ namespace math {
 
 	f64 gauss_legendre(f64 a, f64 b, u8 order, void *params, math::integrand f);
 
+	void gauss_legendre(f64 a, f64 b, u8 order, Vec<f64> &node, Vec<f64> &weight);
+
 	static constexpr f64 factorial(u8 n)
 	{
 		switch (n) {
@@ -76,6 +76,12 @@ numerov::Basis::Basis(String &filename): filename(filename.move())
 	}
 }
 
+numerov::Basis::Basis(usize channel_count): filename(), list(channel_count)
+{
+	// NOTE: In-memory basis of model problems, whose entries (angular momentum
+	// and asymptotic energy, at least) are set by the caller.
+}
+
 //
 // numerov::PotentialEntry:
 //
@@ -93,7 +99,8 @@ static constexpr usize POTENTIAL_FILE_HEADER = sizeof(numerov::MAGIC_NUMBER)
                                              + sizeof(numerov::FORMAT_VERSION)
                                              + sizeof(usize) + 4*sizeof(f64);
 
-numerov::Potential::Potential(c_str filename, u8 fmt_ver): input(filename), entry(0)
+numerov::Potential::Potential(c_str filename, u8 fmt_ver):
+	input(filename), entry(0), block_list(), block_start()
 {
 	CHECK_FILE_HEADER(this->input, fmt_ver);
 
@@ -103,6 +110,8 @@ numerov::Potential::Potential(c_str filename, u8 fmt_ver): input(filename), entr
 	CHECK_FILE_END(this->input)
 
 	this->entry.value.resize(channel_count, channel_count);
+
+	this->read_blocks();
 }
 
 c_str numerov::Potential::filename() const
@@ -139,21 +148,293 @@ Range<f64> numerov::Potential::grid_range()
 	return range;
 }
 
-const numerov::PotentialEntry& numerov::Potential::operator[](usize grid_index)
+static void read_potential(file::Input &input, usize grid_index, mut<f64> &R, Mat<f64> &value)
 {
-	usize stride = sizeof(PotentialEntry::index)
-	             + sizeof(PotentialEntry::R) + this->entry.value.size();
+	// NOTE: The header is followed by the block index of every channel, see
+	// numerov::Potential::read_blocks().
+	usize stride = sizeof(numerov::PotentialEntry::index)
+	             + sizeof(numerov::PotentialEntry::R) + value.size();
 
-	this->input.seek_set(POTENTIAL_FILE_HEADER + grid_index*stride);
+	input.seek_set(POTENTIAL_FILE_HEADER + value.rows()*sizeof(usize) + grid_index*stride);
 
-	CHECK_DATA_INDEX(this->input, grid_index, "grid index")
+	CHECK_DATA_INDEX(input, grid_index, "grid index")
 
-	this->input.read(this->entry.R);
-	this->input.read(this->entry.value);
+	input.read(R);
+	input.read(value);
+}
+
+const numerov::PotentialEntry& numerov::Potential::operator[](usize grid_index)
+{
+	read_potential(this->input, grid_index, this->entry.R, this->entry.value);
 
 	return this->entry;
 }
 
+usize numerov::Potential::block_count() const
+{
+	return this->block_start.length() - 1;
+}
+
+usize numerov::Potential::block_size(usize block_index) const
+{
+	assert(block_index < this->block_count());
+	return this->block_start[block_index + 1] - this->block_start[block_index];
+}
+
+usize numerov::Potential::block_channel(usize block_index, usize n) const
+{
+	// NOTE: The n-th channel of a block, as an index of the full coupling matrix.
+	assert(n < this->block_size(block_index));
+	return this->block_list[this->block_start[block_index] + n];
+}
+
+void numerov::Potential::copy_block(usize block_index,
+                                    const Mat<f64> &value, Mat<f64> &block) const
+{
+	usize size = this->block_size(block_index);
+
+	assert(value.rows() == this->channel_count());
+	assert(block.rows() == size);
+	assert(block.cols() == size);
+
+	for (mut<usize> a = 0; a < size; ++a) {
+		usize channel_a = this->block_channel(block_index, a);
+
+		for (mut<usize> b = 0; b < size; ++b) {
+			block(a, b) = value(channel_a, this->block_channel(block_index, b));
+		}
+	}
+}
+
+void numerov::Potential::read_blocks()
+{
+	// NOTE: The block index of every channel is written by the coupling matrix driver,
+	// from the selection rules of the angular couplings (e.g. different J or parity),
+	// rather than inferred from the values of the coupling matrices. Blocks are
+	// numbered in the order of their lowest channel, and channels of a block are
+	// kept in ascending order.
+
+	usize channel_count = this->channel_count();
+
+	Vec<usize> block_index(channel_count);
+
+	this->input.seek_set(POTENTIAL_FILE_HEADER);
+	this->input.read(block_index);
+
+	CHECK_FILE_END(this->input)
+
+	mut<usize> count = 0;
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		if (block_index[channel] > count) {
+			print::error(WHERE, "Invalid block index ", block_index[channel], " of channel ", channel, " in ", this->filename());
+		}
+
+		count += (block_index[channel] == count? 1 : 0);
+	}
+
+	//
+	// Sort channels by block: block_start[n] is the position in block_list of the
+	// first channel of the n-th block, and the last entry is the channel count.
+	//
+
+	this->block_list.resize(channel_count);
+	this->block_start.resize(count + 1);
+
+	mut<usize> position = 0;
+
+	for (mut<usize> block = 0; block < count; ++block) {
+		this->block_start[block] = position;
+
+		for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+			if (block_index[channel] == block) {
+				this->block_list[position] = channel;
+				++position;
+			}
+		}
+	}
+
+	this->block_start[count] = position;
+}
+
+//
+// numerov::PotentialStream:
+//
+
+// NOTE: States of the buffers of a potential stream. A buffer is requested by the
+// caller, read by the reader thread, and then handed out by operator[]() once ready.
+static constexpr u8 BUFFER_FREE = 0;
+static constexpr u8 BUFFER_REQUESTED = 1;
+static constexpr u8 BUFFER_READING = 2;
+static constexpr u8 BUFFER_READY = 3;
+
+numerov::PotentialStream::PotentialStream(const numerov::Potential &coupling, usize window):
+	input(coupling.filename()), stack(), value(window + 2), index(window + 2), state(window + 2),
+	is_closed(false), lock(), changed(), reader()
+{
+	// NOTE: Besides the window of requested matrices, one buffer holds the matrix
+	// handed out last, and another is kept free for matrices not requested ahead.
+
+	usize channel_count = coupling.channel_count();
+	usize size = channel_count*channel_count;
+
+	this->stack.resize((window + 2)*size);
+
+	for (mut<usize> n = 0; n < (window + 2); ++n) {
+		Vec<f64> slice(size, &this->stack[n*size]);
+
+		Mat<f64> buffer(channel_count, channel_count, slice);
+
+		this->value[n].swap(buffer);
+		this->state[n] = BUFFER_FREE;
+	}
+
+	this->reader = std::thread(&numerov::PotentialStream::read_loop, this);
+}
+
+usize numerov::PotentialStream::window() const
+{
+	return this->value.length() - 2;
+}
+
+void numerov::PotentialStream::request(usize grid_index)
+{
+	// NOTE: Schedules the reading of a grid point in the background. The request is
+	// dropped if the window is full, and the point is then read by operator[]().
+
+	std::unique_lock<std::mutex> guard(this->lock);
+
+	mut<usize> free_count = 0;
+	mut<usize> free_buffer = 0;
+
+	for (mut<usize> n = 0; n < this->value.length(); ++n) {
+		if (this->state[n] == BUFFER_FREE) {
+			free_buffer = n;
+			++free_count;
+		} else if (this->index[n] == grid_index) {
+			return;
+		}
+	}
+
+	if (free_count < 2) {
+		return;
+	}
+
+	this->index[free_buffer] = grid_index;
+	this->state[free_buffer] = BUFFER_REQUESTED;
+
+	this->changed.notify_all();
+}
+
+const Mat<f64>& numerov::PotentialStream::operator[](usize grid_index)
+{
+	// NOTE: Grid points are expected in ascending order. The matrix handed out is
+	// not copied and remains valid until the next call, which releases all buffers
+	// of lower grid indices, including requests that turned out to be skipped.
+
+	std::unique_lock<std::mutex> guard(this->lock);
+
+	mut<usize> buffer = this->value.length();
+
+	for (mut<usize> n = 0; n < this->value.length(); ++n) {
+		if ((this->state[n] == BUFFER_READY) || (this->state[n] == BUFFER_REQUESTED)) {
+			if (this->index[n] < grid_index) {
+				this->state[n] = BUFFER_FREE;
+			}
+		}
+
+		if ((this->state[n] != BUFFER_FREE) && (this->index[n] == grid_index)) {
+			buffer = n;
+		}
+	}
+
+	if (buffer == this->value.length()) {
+		for (mut<usize> n = 0; n < this->value.length(); ++n) {
+			if (this->state[n] == BUFFER_FREE) {
+				buffer = n;
+			}
+		}
+
+		if (buffer == this->value.length()) {
+			print::error(WHERE, "No free buffer for grid index ", grid_index, " when reading ", this->input.filename.as_cstr());
+		}
+
+		this->index[buffer] = grid_index;
+		this->state[buffer] = BUFFER_REQUESTED;
+
+		this->changed.notify_all();
+	}
+
+	while (this->state[buffer] != BUFFER_READY) {
+		this->changed.wait(guard);
+	}
+
+	return this->value[buffer];
+}
+
+void numerov::PotentialStream::read_loop()
+{
+	// NOTE: Body of the reader thread, which reads requested grid points in ascending
+	// order. The file is only accessed by this thread, and the lock is released
+	// while reading.
+
+	std::unique_lock<std::mutex> guard(this->lock);
+
+	while (this->is_closed == false) {
+		mut<usize> buffer = this->value.length();
+
+		for (mut<usize> n = 0; n < this->value.length(); ++n) {
+			if (this->state[n] != BUFFER_REQUESTED) {
+				continue;
+			}
+
+			if ((buffer == this->value.length()) || (this->index[n] < this->index[buffer])) {
+				buffer = n;
+			}
+		}
+
+		if (buffer == this->value.length()) {
+			this->changed.wait(guard);
+			continue;
+		}
+
+		this->state[buffer] = BUFFER_READING;
+
+		usize grid_index = this->index[buffer];
+
+		guard.unlock();
+
+		mut<f64> R = 0.0;
+		read_potential(this->input, grid_index, R, this->value[buffer]);
+
+		guard.lock();
+
+		this->state[buffer] = BUFFER_READY;
+
+		this->changed.notify_all();
+	}
+}
+
+numerov::PotentialStream::~PotentialStream()
+{
+	{
+		std::unique_lock<std::mutex> guard(this->lock);
+		this->is_closed = true;
+	}
+
+	this->changed.notify_all();
+	this->reader.join();
+}
+
+//
+// numerov::Eigenbasis:
+//
+
+numerov::Eigenbasis::Eigenbasis(usize channel_count):
+	value(channel_count), vector(channel_count, channel_count)
+{
+}
+
 //
 // numerov::RatioEntry:
 //
@@ -166,8 +447,9 @@ numerov::RatioEntry::RatioEntry(usize channel_count):
 usize numerov::RatioEntry::size() const
 {
 	// NOTE: The ratio entry size in the binary file is that of a RatioEntry struct plus
-	// two usize indices tracking the grid and energy indices.
-	return 2*sizeof(usize) + sizeof(this->R) + sizeof(this->energy) + this->value.size();
+	// the usize energy index, but without R, which is the matching radius of all
+	// entries (see numerov::Ratio::match_radius()).
+	return sizeof(usize) + sizeof(this->energy) + this->value.size();
 }
 
 //
@@ -177,9 +459,9 @@ usize numerov::RatioEntry::size() const
 static constexpr usize RATIO_FILE_HEADER = sizeof(numerov::MAGIC_NUMBER)
                                          + sizeof(numerov::FORMAT_VERSION)
                                          + sizeof(usize) + sizeof(f64)
-                                         + 2*sizeof(Range<f64>);
+                                         + 2*sizeof(Range<f64>) + sizeof(f64);
 
-numerov::Ratio::Ratio(c_str filename, u8 fmt_ver): stride(0), input(filename), entry(0)
+numerov::Ratio::Ratio(c_str filename, u8 fmt_ver): energy_count(0), input(filename), entry(0)
 {
 	CHECK_FILE_HEADER(this->input, fmt_ver);
 
@@ -189,7 +471,8 @@ numerov::Ratio::Ratio(c_str filename, u8 fmt_ver): stride(0), input(filename), e
 	CHECK_FILE_END(this->input)
 
 	this->entry.value.resize(channel_count, channel_count);
-	this->stride = this->energy_range().count();
+	this->energy_count = this->energy_range().count();
+	this->entry.R = this->match_radius();
 }
 
 c_str numerov::Ratio::filename() const
@@ -199,7 +482,7 @@ c_str numerov::Ratio::filename() const
 
 f64 numerov::Ratio::reduced_mass()
 {
-	static constexpr usize HEADER_OFFSET = sizeof(f64) + 2*sizeof(Range<f64>);
+	static constexpr usize HEADER_OFFSET = sizeof(f64) + 2*sizeof(Range<f64>) + sizeof(f64);
 
 	this->input.seek_set(RATIO_FILE_HEADER - HEADER_OFFSET);
 
@@ -218,7 +501,7 @@ usize numerov::Ratio::channel_count() const
 
 Range<f64> numerov::Ratio::grid_range()
 {
-	static constexpr usize HEADER_OFFSET = 2*sizeof(Range<f64>);
+	static constexpr usize HEADER_OFFSET = 2*sizeof(Range<f64>) + sizeof(f64);
 
 	this->input.seek_set(RATIO_FILE_HEADER - HEADER_OFFSET);
 
@@ -232,7 +515,7 @@ Range<f64> numerov::Ratio::grid_range()
 
 Range<f64> numerov::Ratio::energy_range()
 {
-	static constexpr usize HEADER_OFFSET = sizeof(Range<f64>);
+	static constexpr usize HEADER_OFFSET = sizeof(Range<f64>) + sizeof(f64);
 
 	this->input.seek_set(RATIO_FILE_HEADER - HEADER_OFFSET);
 
@@ -244,172 +527,460 @@ Range<f64> numerov::Ratio::energy_range()
 	return range;
 }
 
-const numerov::RatioEntry& numerov::Ratio::operator()(usize grid_index,
-                                                      usize energy_index)
+f64 numerov::Ratio::match_radius()
+{
+	// NOTE: The last grid point visited by the propagation, at which all ratio
+	// matrices are to be matched. Since the grid is half-open, it is at most
+	// one step before the end of the grid range.
+
+	static constexpr usize HEADER_OFFSET = sizeof(f64);
+
+	this->input.seek_set(RATIO_FILE_HEADER - HEADER_OFFSET);
+
+	CHECK_FILE_END(this->input)
+
+	mut<f64> R = 0.0;
+	this->input.read(R);
+
+	return R;
+}
+
+const numerov::RatioEntry& numerov::Ratio::operator()(usize energy_index)
 {
-	// NOTE: The file layout of Numerov solutions is of a matrix of ratio matrices
-	// stored in a row-major fashion. Rows store R-dependent entries, and columns
-	// are for total-energy-dependent ones. Thus, the size of a row (in bytes) is
-	// the number of energies (called stride) times the byte count of one element,
-	// which is the size of a RatioEntry struct plus two usize indices tracking the
-	// grid and energy indices.
-	usize offset = (grid_index*this->stride + energy_index)*this->entry.size();
+	// NOTE: Numerov solutions are stored in the order of their energy index, each
+	// one as the size of a RatioEntry struct plus the usize energy index, but
+	// without R, which is that of the header.
+	assert(energy_index < this->energy_count);
 
-	this->input.seek_set(RATIO_FILE_HEADER + offset);
+	this->input.seek_set(RATIO_FILE_HEADER + energy_index*this->entry.size());
 
-	CHECK_DATA_INDEX(this->input, grid_index, "grid index")
 	CHECK_DATA_INDEX(this->input, energy_index, "energy index")
 
-	this->input.read(this->entry.R);
 	this->input.read(this->entry.energy);
 	this->input.read(this->entry.value);
 
 	return this->entry;
 }
 
-//
-// numerov::ScattMatrix:
-//
+static u32 energy_team_size(usize energy_count)
+{
+	// NOTE: The energies of a batch are shared among OpenMP threads, and threads left
+	// without any energy are lent to the BLAS/LAPACK backend of the others instead
+	// (see blas::set_local_thread_count()), so that no core is oversubscribed.
 
-static constexpr usize SMATRIX_HEADER_OFFSET = sizeof(numerov::FORMAT_VERSION)
-                                             + sizeof(numerov::MAGIC_NUMBER)
-                                             + 2*sizeof(usize) + sizeof(f64);
+	usize count = std::min(as_usize(max_thread_count()), energy_count);
 
-numerov::ScattMatrix::ScattMatrix(c_str filename, u8 fmt_ver):
-	input(filename), entry(type_zeroed<numerov::ScattMatrixEntry>())
-{
-	CHECK_FILE_HEADER(this->input, fmt_ver);
+	return as_u32(count > 0? count : 1);
+}
 
-	this->input.read(this->entry.channel_count);
+//
+// numerov::Workspace:
+//
 
-	mut<usize> energy_count = 0;
-	this->input.read(energy_count);
+// NOTE: Number of N-by-N matrices and of N-element diagonals held by a workspace,
+// as needed by the most demanding routines, i.e., the renormalized Numerov step
+// with closed-channel pruning and numerov::build_ratio_matrix().
+static constexpr usize WORKSPACE_MATRIX_COUNT = 4;
+static constexpr usize WORKSPACE_DIAGONAL_COUNT = 4;
+static constexpr usize WORKSPACE_SINGLE_MATRIX_COUNT = 3;
 
-	this->input.read(this->entry.mass);
+numerov::Workspace::Workspace(usize channel_count, bool use_single_precision):
+	max_channel_count(channel_count), stack(), ipiv(channel_count), lapack_work(), single_stack(), single_lapack_work()
+{
+	this->stack.resize(WORKSPACE_MATRIX_COUNT*channel_count*channel_count
+	                   + WORKSPACE_DIAGONAL_COUNT*channel_count);
 
-	CHECK_FILE_END(this->input)
+	usize sytri_length = lapack::sytri_work_length<f64>(channel_count);
+	usize syev_length = lapack::syev_work_length<f64>(channel_count);
 
-	this->entry.total_energy.resize(energy_count);
-	this->entry.value.resize(energy_count);
+	this->lapack_work.resize(sytri_length > syev_length? sytri_length : syev_length);
 
-	// NOTE: For every pair of channels, ab, there must be this number of bytes
-	// written in the input file. That is, the size of a numerov::ScattMatrixEntry
-	// object (without the 'size' and 'channel_count' members) plus three extra
-	// integers stored for internal checks (channels and energy indices, all usize).
-	this->entry.size = 2*sizeof(usize) + 14*sizeof(s32) + 2*sizeof(f64)
-	                 + energy_count*(sizeof(usize) + 3*sizeof(f64));
+	// NOTE: Only the mixed-precision Numerov step uses single-precision matrices,
+	// see numerov::renormalized_mixed().
+	if (use_single_precision) {
+		this->single_stack.resize(WORKSPACE_SINGLE_MATRIX_COUNT*channel_count*channel_count);
+		this->single_lapack_work.resize(lapack::sytri_work_length<f32>(channel_count));
+	}
 }
 
-c_str numerov::ScattMatrix::filename() const
+usize numerov::Workspace::channel_count() const
 {
-	return this->input.filename.as_cstr();
+	return this->max_channel_count;
 }
 
-f64 numerov::ScattMatrix::reduced_mass() const
+Mat<f64> numerov::Workspace::matrix(usize index, usize channel_count)
 {
-	return this->entry.mass;
+	// NOTE: Returns a view of the index-th scratch matrix, which can be smaller
+	// than the one the workspace was built for, e.g., for a block of channels.
+
+	assert(index < WORKSPACE_MATRIX_COUNT);
+	assert(channel_count <= this->max_channel_count);
+
+	usize size = this->max_channel_count*this->max_channel_count;
+
+	Vec<f64> slice(channel_count*channel_count, &this->stack[index*size]);
+
+	return Mat<f64>(channel_count, channel_count, slice);
 }
 
-usize numerov::ScattMatrix::channel_count() const
+Vec<f64> numerov::Workspace::diagonal(usize index, usize channel_count)
 {
-	return this->entry.channel_count;
+	assert(index < WORKSPACE_DIAGONAL_COUNT);
+	assert(channel_count <= this->max_channel_count);
+
+	usize offset = WORKSPACE_MATRIX_COUNT*this->max_channel_count*this->max_channel_count;
+
+	return Vec<f64>(channel_count, &this->stack[offset + index*this->max_channel_count]);
 }
 
-usize numerov::ScattMatrix::energy_count() const
+Vec<s32> numerov::Workspace::pivot(usize channel_count)
 {
-	return this->entry.value.length();
+	assert(channel_count <= this->max_channel_count);
+	return Vec<s32>(channel_count, &this->ipiv[0]);
 }
 
-const numerov::ScattMatrixEntry& numerov::ScattMatrix::operator()(usize channel_a,
-                                                                  usize channel_b)
+Vec<f64>& numerov::Workspace::work()
 {
-	// NOTE: Using a row-major layout, where each element is this->entry.size long.
-	usize stride = (channel_a*this->entry.channel_count + channel_b)*this->entry.size;
-
-	this->input.seek_set(SMATRIX_HEADER_OFFSET + stride);
-
-	CHECK_DATA_INDEX(this->input, channel_a, "channel a")
-	CHECK_DATA_INDEX(this->input, channel_b, "channel b")
+	return this->lapack_work;
+}
 
-	this->input.read(this->entry.n_in);
-	this->input.read(this->entry.v_in);
-	this->input.read(this->entry.j_in);
-	this->input.read(this->entry.J_in);
-	this->input.read(this->entry.l_in);
-	this->input.read(this->entry.p_in);
-	this->input.read(this->entry.c_in);
-	this->input.read(this->entry.eigenval_in);
+Mat<f32> numerov::Workspace::single_matrix(usize index, usize channel_count)
+{
+	assert(index < WORKSPACE_SINGLE_MATRIX_COUNT);
+	assert(channel_count <= this->max_channel_count);
+	assert(this->single_stack.length() > 0);
 
-	this->input.read(this->entry.n_out);
-	this->input.read(this->entry.v_out);
-	this->input.read(this->entry.j_out);
-	this->input.read(this->entry.J_out);
-	this->input.read(this->entry.l_out);
-	this->input.read(this->entry.p_out);
-	this->input.read(this->entry.c_out);
-	this->input.read(this->entry.eigenval_out);
+	usize size = this->max_channel_count*this->max_channel_count;
 
-	for (mut<usize> n = 0; n < this->entry.value.length(); ++n) {
-		CHECK_DATA_INDEX(this->input, n, "energy index")
+	Vec<f32> slice(channel_count*channel_count, &this->single_stack[index*size]);
 
-		this->input.read(this->entry.total_energy[n]);
+	return Mat<f32>(channel_count, channel_count, slice);
+}
 
-		mut<f64> re_s = 0.0;
-		this->input.read(re_s);
+Vec<f32>& numerov::Workspace::single_work()
+{
+	return this->single_lapack_work;
+}
 
-		mut<f64> im_s = 0.0;
-		this->input.read(im_s);
+void numerov::Workspace::swap(numerov::Workspace &other)
+{
+	auto max_channel_count = this->max_channel_count;
 
-		this->entry.value[n] = c64(re_s, im_s);
-	}
+	this->max_channel_count = other.max_channel_count;
+	other.max_channel_count = max_channel_count;
 
-	return this->entry;
+	this->stack.swap(other.stack);
+	this->ipiv.swap(other.ipiv);
+	this->lapack_work.swap(other.lapack_work);
+	this->single_stack.swap(other.single_stack);
+	this->single_lapack_work.swap(other.single_lapack_work);
 }
 
 //
-// numerov::ScattAmplitude:
+// numerov::ActiveSet:
 //
 
-numerov::ScattAmplitude::ScattAmplitude(u32 j_in, u32 j_out, usize theta_count, usize energy_count):
-	entry((2*j_in + 1)*(2*j_out + 1))
+numerov::ActiveSet::ActiveSet(usize channel_count, usize energy_count):
+	active_count(energy_count), active_list(energy_count, channel_count)
 {
-	mut<usize> mm_index = 0;
-
-	for (mut<s32> m_in = -as_s32(j_in); m_in <= as_s32(j_in); ++m_in) {
-		for (mut<s32> m_out = -as_s32(j_out); m_out <= as_s32(j_out); ++m_out) {
-			Vec<Vec<c64>> theta_list(theta_count);
-
-			this->entry[mm_index].m_in = m_in;
-			this->entry[mm_index].m_out = m_out;
-			this->entry[mm_index].value.swap(theta_list);
-
-			for (mut<usize> theta_index = 0; theta_index < theta_count; ++theta_index) {
-				Vec<c64> energy_list(energy_count);
-
-				this->entry[mm_index].value[theta_index].swap(energy_list);
-			}
+	// NOTE: All channels start active, in their original order.
+	for (mut<usize> energy = 0; energy < energy_count; ++energy) {
+		this->active_count[energy] = channel_count;
 
-			mm_index += 1;
+		for (mut<usize> n = 0; n < channel_count; ++n) {
+			this->active_list(energy, n) = n;
 		}
 	}
 }
 
-usize numerov::ScattAmplitude::mm_count() const
+usize numerov::ActiveSet::channel_count() const
 {
-	return this->entry.length();
+	return (this->active_count.length() > 0? this->active_list.cols() : 0);
 }
 
-usize numerov::ScattAmplitude::theta_count() const
+usize numerov::ActiveSet::energy_count() const
 {
-	return this->entry[0].value.length();
+	return this->active_count.length();
 }
 
-usize numerov::ScattAmplitude::energy_count() const
+usize numerov::ActiveSet::count(usize energy_index) const
 {
-	return this->entry[0].value[0].length();
+	assert(energy_index < this->active_count.length());
+	return this->active_count[energy_index];
 }
 
-c64 numerov::ScattAmplitude::mm_sum(usize theta_index, usize energy_index) const
+usize numerov::ActiveSet::channel(usize energy_index, usize n) const
+{
+	// NOTE: The n-th active channel of an energy, as an index of the coupling matrix.
+	assert(n < this->count(energy_index));
+	return this->active_list(energy_index, n);
+}
+
+void numerov::ActiveSet::remove(usize energy_index, usize n)
+{
+	usize count = this->count(energy_index);
+
+	assert(n < count);
+
+	for (mut<usize> m = n; m < (count - 1); ++m) {
+		this->active_list(energy_index, m) = this->active_list(energy_index, m + 1);
+	}
+
+	this->active_count[energy_index] = count - 1;
+}
+
+void numerov::ActiveSet::insert(usize energy_index, usize channel)
+{
+	// NOTE: The channel is placed so that active ones remain in their original order.
+	mut<usize> n = this->count(energy_index);
+
+	assert(n < this->channel_count());
+
+	while ((n > 0) && (this->active_list(energy_index, n - 1) > channel)) {
+		this->active_list(energy_index, n) = this->active_list(energy_index, n - 1);
+		--n;
+	}
+
+	assert((n == 0) || (this->active_list(energy_index, n - 1) != channel));
+
+	this->active_list(energy_index, n) = channel;
+	this->active_count[energy_index] += 1;
+}
+
+void numerov::ActiveSet::swap(numerov::ActiveSet &other)
+{
+	this->active_count.swap(other.active_count);
+	this->active_list.swap(other.active_list);
+}
+
+//
+// numerov::RatioBatch:
+//
+
+// NOTE: Ratio matrices in a batch start at a cache line boundary, thus the stride
+// between consecutive matrices is padded to a multiple of this many elements.
+static constexpr usize RATIO_BATCH_ALIGNMENT = 64/sizeof(f64);
+
+numerov::RatioBatch::RatioBatch(usize channel_count, usize energy_count):
+	offset(0), padded_size(0), stack(), entry(energy_count)
+{
+	usize size = channel_count*channel_count;
+
+	this->padded_size = RATIO_BATCH_ALIGNMENT*((size + RATIO_BATCH_ALIGNMENT - 1)/RATIO_BATCH_ALIGNMENT);
+
+	// NOTE: The stack is allocated with one extra cache line so that its first
+	// matrix can be shifted to an aligned address, which realloc() does not
+	// guarantee. All matrices start zeroed.
+	this->stack.resize(energy_count*this->padded_size + RATIO_BATCH_ALIGNMENT);
+
+	usize address = reinterpret_cast<std::uintptr_t>(&this->stack[0]);
+	usize misalignment = address%(RATIO_BATCH_ALIGNMENT*sizeof(f64));
+
+	if (misalignment != 0) {
+		this->offset = RATIO_BATCH_ALIGNMENT - misalignment/sizeof(f64);
+	}
+
+	// NOTE: Each entry is a fixed view of its own slice of the stack.
+	for (mut<usize> n = 0; n < energy_count; ++n) {
+		Vec<f64> slice(size, &this->stack[this->offset + n*this->padded_size]);
+
+		Mat<f64> ratio(channel_count, channel_count, slice);
+
+		this->entry[n].swap(ratio);
+	}
+}
+
+numerov::RatioBatch::RatioBatch(numerov::RatioBatch &batch, usize first_energy, usize last_energy):
+	offset(0), padded_size(batch.padded_size),
+	stack((last_energy - first_energy)*batch.padded_size, &batch.stack[batch.offset + first_energy*batch.padded_size]),
+	entry(last_energy - first_energy, &batch.entry[first_energy])
+{
+	// NOTE: A view of the ratio matrices of a batch from first_energy up to, but not
+	// including, last_energy, which are neither copied nor released by the view.
+
+	assert(first_energy < last_energy);
+	assert(last_energy <= batch.energy_count());
+}
+
+usize numerov::RatioBatch::channel_count() const
+{
+	return (this->entry.length() > 0? this->entry[0].rows() : 0);
+}
+
+usize numerov::RatioBatch::energy_count() const
+{
+	return this->entry.length();
+}
+
+usize numerov::RatioBatch::stride() const
+{
+	return this->padded_size;
+}
+
+Mat<f64>& numerov::RatioBatch::operator[](usize energy_index) const
+{
+	assert(energy_index < this->entry.length());
+	return this->entry[energy_index];
+}
+
+void numerov::RatioBatch::swap(numerov::RatioBatch &other)
+{
+	auto offset = this->offset;
+	auto padded_size = this->padded_size;
+
+	this->offset = other.offset;
+	this->padded_size = other.padded_size;
+
+	other.offset = offset;
+	other.padded_size = padded_size;
+
+	this->stack.swap(other.stack);
+	this->entry.swap(other.entry);
+}
+
+//
+// numerov::ScattMatrix:
+//
+
+static constexpr usize SMATRIX_HEADER_OFFSET = sizeof(numerov::FORMAT_VERSION)
+                                             + sizeof(numerov::MAGIC_NUMBER)
+                                             + 2*sizeof(usize) + sizeof(f64);
+
+numerov::ScattMatrix::ScattMatrix(c_str filename, u8 fmt_ver):
+	input(filename), entry(type_zeroed<numerov::ScattMatrixEntry>())
+{
+	CHECK_FILE_HEADER(this->input, fmt_ver);
+
+	this->input.read(this->entry.channel_count);
+
+	mut<usize> energy_count = 0;
+	this->input.read(energy_count);
+
+	this->input.read(this->entry.mass);
+
+	CHECK_FILE_END(this->input)
+
+	this->entry.total_energy.resize(energy_count);
+	this->entry.value.resize(energy_count);
+
+	// NOTE: For every pair of channels, ab, there must be this number of bytes
+	// written in the input file. That is, the size of a numerov::ScattMatrixEntry
+	// object (without the 'size' and 'channel_count' members) plus three extra
+	// integers stored for internal checks (channels and energy indices, all usize).
+	this->entry.size = 2*sizeof(usize) + 14*sizeof(s32) + 2*sizeof(f64)
+	                 + energy_count*(sizeof(usize) + 3*sizeof(f64));
+}
+
+c_str numerov::ScattMatrix::filename() const
+{
+	return this->input.filename.as_cstr();
+}
+
+f64 numerov::ScattMatrix::reduced_mass() const
+{
+	return this->entry.mass;
+}
+
+usize numerov::ScattMatrix::channel_count() const
+{
+	return this->entry.channel_count;
+}
+
+usize numerov::ScattMatrix::energy_count() const
+{
+	return this->entry.value.length();
+}
+
+const numerov::ScattMatrixEntry& numerov::ScattMatrix::operator()(usize channel_a,
+                                                                  usize channel_b)
+{
+	// NOTE: Using a row-major layout, where each element is this->entry.size long.
+	usize stride = (channel_a*this->entry.channel_count + channel_b)*this->entry.size;
+
+	this->input.seek_set(SMATRIX_HEADER_OFFSET + stride);
+
+	CHECK_DATA_INDEX(this->input, channel_a, "channel a")
+	CHECK_DATA_INDEX(this->input, channel_b, "channel b")
+
+	this->input.read(this->entry.n_in);
+	this->input.read(this->entry.v_in);
+	this->input.read(this->entry.j_in);
+	this->input.read(this->entry.J_in);
+	this->input.read(this->entry.l_in);
+	this->input.read(this->entry.p_in);
+	this->input.read(this->entry.c_in);
+	this->input.read(this->entry.eigenval_in);
+
+	this->input.read(this->entry.n_out);
+	this->input.read(this->entry.v_out);
+	this->input.read(this->entry.j_out);
+	this->input.read(this->entry.J_out);
+	this->input.read(this->entry.l_out);
+	this->input.read(this->entry.p_out);
+	this->input.read(this->entry.c_out);
+	this->input.read(this->entry.eigenval_out);
+
+	for (mut<usize> n = 0; n < this->entry.value.length(); ++n) {
+		CHECK_DATA_INDEX(this->input, n, "energy index")
+
+		this->input.read(this->entry.total_energy[n]);
+
+		mut<f64> re_s = 0.0;
+		this->input.read(re_s);
+
+		mut<f64> im_s = 0.0;
+		this->input.read(im_s);
+
+		this->entry.value[n] = c64(re_s, im_s);
+	}
+
+	return this->entry;
+}
+
+//
+// numerov::ScattAmplitude:
+//
+
+numerov::ScattAmplitude::ScattAmplitude(u32 j_in, u32 j_out, usize theta_count, usize energy_count):
+	entry((2*j_in + 1)*(2*j_out + 1))
+{
+	mut<usize> mm_index = 0;
+
+	for (mut<s32> m_in = -as_s32(j_in); m_in <= as_s32(j_in); ++m_in) {
+		for (mut<s32> m_out = -as_s32(j_out); m_out <= as_s32(j_out); ++m_out) {
+			Vec<Vec<c64>> theta_list(theta_count);
+
+			this->entry[mm_index].m_in = m_in;
+			this->entry[mm_index].m_out = m_out;
+			this->entry[mm_index].value.swap(theta_list);
+
+			for (mut<usize> theta_index = 0; theta_index < theta_count; ++theta_index) {
+				Vec<c64> energy_list(energy_count);
+
+				this->entry[mm_index].value[theta_index].swap(energy_list);
+			}
+
+			mm_index += 1;
+		}
+	}
+}
+
+usize numerov::ScattAmplitude::mm_count() const
+{
+	return this->entry.length();
+}
+
+usize numerov::ScattAmplitude::theta_count() const
+{
+	return this->entry[0].value.length();
+}
+
+usize numerov::ScattAmplitude::energy_count() const
+{
+	return this->entry[0].value[0].length();
+}
+
+c64 numerov::ScattAmplitude::mm_sum(usize theta_index, usize energy_index) const
 {
 	mut<c64> sum = c64(0.0, 0.0);
 
@@ -430,110 +1001,1180 @@ Vec<c64>& numerov::ScattAmplitude::operator()(usize mm_index, usize theta_index)
 	return this->entry[mm_index].value[theta_index];
 }
 
-c64& numerov::ScattAmplitude::operator()(usize mm_index, usize theta_index, usize energy_index) const
+c64& numerov::ScattAmplitude::operator()(usize mm_index, usize theta_index, usize energy_index) const
+{
+	return this->entry[mm_index].value[theta_index][energy_index];
+}
+
+//
+// Public API:
+//
+
+void numerov::renormalized(f64 mass,
+                           f64 step,
+                           f64 total_energy,
+                           const Mat<f64> &potential,
+                           numerov::Workspace &workspace,
+                           Mat<f64> &old_ratio,
+                           Mat<f64> &new_ratio)
+{
+	// NOTE: This routine implements the renormalized Numerov algorithm of Johnson,
+	// which propagates the ratio of the wavefunction from a previous grid point to
+	// the current one. See Eq. (22) of B.R. Johnson. J. Chem. Phys. 69, 4678 (1978).
+	// Quantities cited below such as T, I, U and R (ratio) are defined in Johnson's
+	// paper.
+
+	usize channel_count = potential.rows();
+
+	assert(old_ratio.rows() == channel_count);
+	assert(old_ratio.cols() == channel_count);
+	assert(new_ratio.rows() == channel_count);
+	assert(new_ratio.cols() == channel_count);
+
+	Mat<f64> lhs = workspace.matrix(0, channel_count);
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
+
+	//
+	// Step 1: Invert the previous R matrix.
+	//
+	// NOTE: Both R'^-1 and (I - T)^-1 are added into R below, rather than applied
+	// to a vector, thus they are needed explicitly. An LDL' factorization followed
+	// by its inverse takes about N^3 operations, whereas a factor-and-solve with
+	// N right-hand sides takes about 7N^3/3. Inverse-free forms of this step, such
+	// as propagating R^-1 = A(12I - (10I + R'^-1)A)^-1 with A = (I - T), replace
+	// the two inversions by one LU factor-and-solve plus a matrix product, which
+	// costs more than twice as many operations and was measured slower for all
+	// but the smallest blocks.
+	//
+
+	for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+		if (old_ratio[channel] != 0.0) {
+			lapack::sytri(old_ratio, pivot, workspace.work());
+			break;
+		}
+	}
+
+	//
+	// Step 2: Build the (I - T) matrix of Eq. (20), whose upper triangle is only
+	// referenced below.
+	//
+
+	f64 fact = -step*step*2.0*mass/12.0;
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		lhs(channel_a, channel_a) = 1.0 - fact*(total_energy - potential(channel_a, channel_a));
+
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			lhs(channel_a, channel_b) = 0.0 - fact*(0.0 - potential(channel_a, channel_b));
+		}
+	}
+
+	//
+	// Step 3: Invert (I - T) using its symmetric (LDL') factorization. Since (2I +
+	// 10T) = 12I - 10(I - T), the solution of (I - T)U = (2I + 10T) is U = 12(I -
+	// T)^-1 - 10I, and no general (LU) linear system has to be solved.
+	//
+
+	lapack::sytri(lhs, pivot, workspace.work());
+
+	//
+	// Step 4: Solve Eq. (22) for R = U - R' on the upper triangle, which is then
+	// copied into the lower one, so that R is symmetric by construction.
+	//
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		new_ratio(channel_a, channel_a) = 12.0*lhs(channel_a, channel_a) - 10.0 - old_ratio(channel_a, channel_a);
+
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			new_ratio(channel_a, channel_b)
+				= new_ratio(channel_b, channel_a) = 12.0*lhs(channel_a, channel_b) - old_ratio(channel_a, channel_b);
+		}
+	}
+}
+
+void numerov::renormalized_mixed(f64 mass,
+                                 f64 step,
+                                 f64 total_energy,
+                                 const Mat<f64> &potential,
+                                 numerov::Workspace &workspace,
+                                 Mat<f64> &old_ratio,
+                                 Mat<f64> &new_ratio)
+{
+	// NOTE: Same as the renormalized Numerov step above, but with the O(N^3) work,
+	// i.e., two inversions and one matrix product, carried out in single precision,
+	// while the ratio matrices remain in double precision. Since (I - T) is close to
+	// I for small steps, its inverse is written as I - Q(I + Q)^-1, with Q = -T, so
+	// that only the small part Q(I + Q)^-1 is rounded to single precision. This does
+	// not hold for R', whose diagonal grows exponentially in closed channels, thus
+	// R'^-1 is rounded as a whole. Accuracy relies on the checked double-precision
+	// steps taken every mixed_interval steps by the batch overload below, whose
+	// deviation check switches an energy to double precision once it exceeds
+	// mixed_tolerance. The workspace must be built with single precision enabled.
+	// Only the LAPACKE (and MKL) backends have single-precision routines, thus it
+	// falls back to the double-precision step otherwise.
+
+	#if defined(USE_MKL) || defined(USE_LAPACKE)
+		usize channel_count = potential.rows();
+
+		assert(old_ratio.rows() == channel_count);
+		assert(old_ratio.cols() == channel_count);
+		assert(new_ratio.rows() == channel_count);
+		assert(new_ratio.cols() == channel_count);
+
+		Mat<f32> a = workspace.single_matrix(0, channel_count);
+		Mat<f32> q = workspace.single_matrix(1, channel_count);
+		Mat<f32> u = workspace.single_matrix(2, channel_count);
+
+		Vec<s32> pivot = workspace.pivot(channel_count);
+
+		//
+		// Step 1: Invert the previous R matrix, which is left in old_ratio, as with
+		// numerov::renormalized().
+		//
+		// NOTE: Writing R'^-1 = I - (R' - I)R'^-1 would not help here, since R'^-1 is
+		// small in closed channels and the subtraction cancels most of its digits.
+		//
+
+		mut<bool> is_first = true;
+
+		for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+			if (old_ratio[channel] != 0.0) {
+				is_first = false;
+				break;
+			}
+		}
+
+		if (is_first == false) {
+			for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+				a[channel] = as_f32(old_ratio[channel]);
+			}
+
+			lapack::sytri(a, pivot, workspace.single_work());
+
+			for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+				old_ratio[channel] = as_f64(a[channel]);
+			}
+		}
+
+		//
+		// Step 2: Build the full T and (I - T) matrices of Eq. (20), the former in q.
+		//
+
+		f64 fact = -step*step*2.0*mass/12.0;
+
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			q(channel_a, channel_a) = as_f32(fact*(total_energy - potential(channel_a, channel_a)));
+			a(channel_a, channel_a) = 1.0f - q(channel_a, channel_a);
+
+			for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+				q(channel_a, channel_b) = q(channel_b, channel_a) = as_f32(fact*(0.0 - potential(channel_a, channel_b)));
+				a(channel_a, channel_b) = a(channel_b, channel_a) = 0.0f - q(channel_a, channel_b);
+			}
+		}
+
+		//
+		// Step 3: Invert (I - T) and multiply it by T, such that U = 12(I - T)^-1 -
+		// 10I = 2I + 12T(I - T)^-1.
+		//
+
+		lapack::sytri(a, pivot, workspace.single_work());
+
+		blas::gemm('n', 'n', q, a, u);
+
+		//
+		// Step 4: Solve Eq. (22) for R = U - R', in double precision.
+		//
+
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			new_ratio(channel_a, channel_a) = 2.0 + 12.0*as_f64(u(channel_a, channel_a)) - old_ratio(channel_a, channel_a);
+
+			for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+				new_ratio(channel_a, channel_b)
+					= new_ratio(channel_b, channel_a) = 12.0*as_f64(u(channel_a, channel_b)) - old_ratio(channel_a, channel_b);
+			}
+		}
+	#else
+		numerov::renormalized(mass, step, total_energy, potential, workspace, old_ratio, new_ratio);
+	#endif
+}
+
+f64 numerov::renormalized_checked(f64 mass,
+                                  f64 step,
+                                  f64 total_energy,
+                                  const Mat<f64> &potential,
+                                  numerov::Workspace &workspace,
+                                  Mat<f64> &old_ratio,
+                                  Mat<f64> &new_ratio)
+{
+	// NOTE: Carries out the step in double precision, which corrects the ratio for
+	// the rounding errors of the previous single-precision steps, and the mixed-
+	// precision step from the same previous ratio. Returns the largest deviation
+	// between both new ratios, with each element ab scaled by (|R_aa R_bb|)^-1/2,
+	// since the diagonal of closed channels grows exponentially.
+
+	usize channel_count = potential.rows();
+
+	Mat<f64> old_copy = workspace.matrix(1, channel_count);
+	Mat<f64> estimate = workspace.matrix(2, channel_count);
+
+	for (mut<usize> n = 0; n < channel_count*channel_count; ++n) {
+		old_copy[n] = old_ratio[n];
+	}
+
+	numerov::renormalized_mixed(mass, step, total_energy, potential, workspace, old_copy, estimate);
+
+	numerov::renormalized(mass, step, total_energy, potential, workspace, old_ratio, new_ratio);
+
+	mut<f64> max_deviation = 0.0;
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = channel_a; channel_b < channel_count; ++channel_b) {
+			f64 scale = std::sqrt(std::abs(new_ratio(channel_a, channel_a)*new_ratio(channel_b, channel_b)));
+
+			if (scale > 0.0) {
+				f64 deviation = std::abs(new_ratio(channel_a, channel_b) - estimate(channel_a, channel_b))/scale;
+				max_deviation = std::max(max_deviation, deviation);
+			}
+		}
+	}
+
+	return max_deviation;
+}
+
+s64 numerov::renormalized_nodes(f64 mass,
+                                f64 step,
+                                f64 total_energy,
+                                const Mat<f64> &potential,
+                                numerov::Workspace &workspace,
+                                Mat<f64> &old_ratio,
+                                Mat<f64> &new_ratio)
+{
+	// NOTE: Same step as numerov::renormalized(), but the inertia of both symmetric
+	// factorizations is kept. With F = (I - T)psi, the Numerov equations from the
+	// first to the last grid point, for psi = 0 just outside of them, read M(E)F = 0,
+	// where M(E) = tridiag(I, -U, I) has block pivots -R and increases with E, except
+	// where (I - T) is singular. Thus, the number of eigenvalues of the discretized
+	// problem below E is the sum, over all grid points, of the negative eigenvalues
+	// of R minus those of (I - T), i.e., a multichannel node count. Returns the
+	// contribution of this step, namely that of the previous R matrix and of the
+	// current (I - T), see also numerov::negative_count() for the final R matrix.
+
+	usize channel_count = potential.rows();
+
+	assert(old_ratio.rows() == channel_count);
+	assert(old_ratio.cols() == channel_count);
+	assert(new_ratio.rows() == channel_count);
+	assert(new_ratio.cols() == channel_count);
+
+	Mat<f64> lhs = workspace.matrix(0, channel_count);
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
+
+	mut<s64> node_count = 0;
+
+	//
+	// Step 1: Factorize and invert the previous R matrix, if any.
+	//
+
+	for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+		if (old_ratio[channel] != 0.0) {
+			node_count += as_s64(lapack::sytrf(old_ratio, pivot, workspace.work()));
+
+			lapack::sytri_factored(old_ratio, pivot, workspace.work());
+			break;
+		}
+	}
+
+	//
+	// Step 2: Build, factorize and invert the (I - T) matrix of Eq. (20).
+	//
+
+	f64 fact = -step*step*2.0*mass/12.0;
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		lhs(channel_a, channel_a) = 1.0 - fact*(total_energy - potential(channel_a, channel_a));
+
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			lhs(channel_a, channel_b) = 0.0 - fact*(0.0 - potential(channel_a, channel_b));
+		}
+	}
+
+	node_count -= as_s64(lapack::sytrf(lhs, pivot, workspace.work()));
+
+	lapack::sytri_factored(lhs, pivot, workspace.work());
+
+	//
+	// Step 3: Solve Eq. (22) for R = U - R', as in numerov::renormalized().
+	//
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		new_ratio(channel_a, channel_a) = 12.0*lhs(channel_a, channel_a) - 10.0 - old_ratio(channel_a, channel_a);
+
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			new_ratio(channel_a, channel_b)
+				= new_ratio(channel_b, channel_a) = 12.0*lhs(channel_a, channel_b) - old_ratio(channel_a, channel_b);
+		}
+	}
+
+	return node_count;
+}
+
+usize numerov::negative_count(const Mat<f64> &ratio, numerov::Workspace &workspace)
+{
+	// NOTE: Number of negative eigenvalues of a ratio matrix, which is left as is.
+
+	usize channel_count = ratio.rows();
+
+	assert(ratio.cols() == channel_count);
+
+	Mat<f64> copy = workspace.matrix(1, channel_count);
+
+	for (mut<usize> n = 0; n < channel_count*channel_count; ++n) {
+		copy[n] = ratio[n];
+	}
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
+
+	return lapack::sytrf(copy, pivot, workspace.work());
+}
+
+void numerov::build_eigenbasis(const Mat<f64> &potential, numerov::Workspace &workspace, numerov::Eigenbasis &eigen)
+{
+	// NOTE: On exit, the n-th column of eigen.vector is the eigenvector of the
+	// coupling potential whose eigenvalue is eigen.value[n]. Only the lower
+	// triangle of the potential is referenced by the eigensolver.
+
+	usize channel_count = potential.rows();
+
+	assert(potential.cols() == channel_count);
+	assert(eigen.value.length() == channel_count);
+	assert(eigen.vector.rows() == channel_count);
+	assert(eigen.vector.cols() == channel_count);
+
+	for (mut<usize> n = 0; n < channel_count*channel_count; ++n) {
+		eigen.vector[n] = potential[n];
+	}
+
+	lapack::syev(eigen.vector, eigen.value, workspace.work());
+}
+
+void numerov::renormalized(f64 mass,
+                           f64 step,
+                           f64 total_energy,
+                           const numerov::Eigenbasis &potential,
+                           numerov::Workspace &workspace,
+                           Mat<f64> &old_ratio,
+                           Mat<f64> &new_ratio)
+{
+	// NOTE: This is the same step of Johnson's renormalized Numerov algorithm as
+	// above, but carried out in the eigenbasis C of the coupling potential V = CwC',
+	// built once per grid point by numerov::build_eigenbasis() and shared by all
+	// energies. Since T = fact(EI - V) has the same eigenvectors, U = (I - T)^-1
+	// (2I + 10T) = C diag(u) C', with u = (2 + 10t)/(1 - t) and t = fact(E - w).
+	// Thus, no linear system is solved for U, and the energy only enters through
+	// the diagonal u.
+
+	usize channel_count = potential.value.length();
+
+	assert(old_ratio.rows() == channel_count);
+	assert(old_ratio.cols() == channel_count);
+	assert(new_ratio.rows() == channel_count);
+	assert(new_ratio.cols() == channel_count);
+
+	Mat<f64> scaled = workspace.matrix(0, channel_count);
+
+	//
+	// Step 1: Invert the previous R matrix.
+	//
+
+	for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+		if (old_ratio[channel] != 0.0) {
+			Vec<s32> pivot = workspace.pivot(channel_count);
+
+			lapack::sytri(old_ratio, pivot, workspace.work());
+			break;
+		}
+	}
+
+	//
+	// Step 2: Scale the columns of C by the eigenvalues u of U.
+	//
+
+	f64 fact = -step*step*2.0*mass/12.0;
+
+	for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+		f64 t = fact*(total_energy - potential.value[channel_b]);
+
+		f64 u = (2.0 + 10.0*t)/(1.0 - t);
+
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			scaled(channel_a, channel_b) = potential.vector(channel_a, channel_b)*u;
+		}
+	}
+
+	//
+	// Step 3: Solve Eq. (22) for R = U - R', with U = C diag(u) C' and -R' set
+	// beforehand in new_ratio.
+	//
+
+	for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+		new_ratio[channel] = -old_ratio[channel];
+	}
+
+	blas::gemm<f64>('n', 't', scaled, potential.vector, new_ratio, 1.0, 1.0);
+}
+
+void numerov::renormalized(f64 mass,
+                           f64 step,
+                           const Vec<f64> &total_energy,
+                           const Mat<f64> &potential,
+                           Vec<numerov::Workspace> &workspace,
+                           numerov::RatioBatch &old_ratio,
+                           numerov::RatioBatch &new_ratio)
+{
+	// NOTE: Advances a batch of ratio matrices, one per total energy, by a single
+	// grid step. Energies are independent, thus they are distributed among OpenMP
+	// threads, each one using its own workspace, i.e., workspace[thread_id()].
+
+	usize channel_count = potential.rows();
+
+	assert(old_ratio.channel_count() == channel_count);
+	assert(new_ratio.channel_count() == channel_count);
+	assert(old_ratio.energy_count() == total_energy.length());
+	assert(new_ratio.energy_count() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			numerov::renormalized(mass, step, total_energy[n], potential, workspace[thread_id()], old_ratio[n], new_ratio[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::renormalized_mixed(f64 mass,
+                                 f64 step,
+                                 const Vec<f64> &total_energy,
+                                 const Mat<f64> &potential,
+                                 f64 tolerance,
+                                 bool is_checked,
+                                 Vec<f64> &deviation,
+                                 Vec<numerov::Workspace> &workspace,
+                                 numerov::RatioBatch &old_ratio,
+                                 numerov::RatioBatch &new_ratio)
+{
+	// NOTE: Advances a batch of ratio matrices as above, with the mixed-precision
+	// step. On checked steps, the double-precision step is used instead, and the
+	// deviation of the mixed one is saved per energy. Energies whose deviation has
+	// exceeded the tolerance are propagated in double precision from then on.
+
+	usize channel_count = potential.rows();
+
+	assert(old_ratio.channel_count() == channel_count);
+	assert(new_ratio.channel_count() == channel_count);
+	assert(old_ratio.energy_count() == total_energy.length());
+	assert(new_ratio.energy_count() == total_energy.length());
+	assert(deviation.length() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			auto &thread_workspace = workspace[thread_id()];
+
+			if (deviation[n] > tolerance) {
+				numerov::renormalized(mass, step, total_energy[n], potential, thread_workspace, old_ratio[n], new_ratio[n]);
+			} else if (is_checked) {
+				deviation[n] = numerov::renormalized_checked(mass, step, total_energy[n], potential, thread_workspace, old_ratio[n], new_ratio[n]);
+			} else {
+				numerov::renormalized_mixed(mass, step, total_energy[n], potential, thread_workspace, old_ratio[n], new_ratio[n]);
+			}
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::renormalized_nodes(f64 mass,
+                                 f64 step,
+                                 const Vec<f64> &total_energy,
+                                 const Mat<f64> &potential,
+                                 Vec<numerov::Workspace> &workspace,
+                                 numerov::RatioBatch &old_ratio,
+                                 numerov::RatioBatch &new_ratio,
+                                 Vec<s64> &node_count)
+{
+	// NOTE: Advances a batch of ratio matrices as above, while the node count of
+	// each step is added to node_count, one per total energy.
+
+	usize channel_count = potential.rows();
+
+	assert(old_ratio.channel_count() == channel_count);
+	assert(new_ratio.channel_count() == channel_count);
+	assert(old_ratio.energy_count() == total_energy.length());
+	assert(new_ratio.energy_count() == total_energy.length());
+	assert(node_count.length() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			node_count[n] += numerov::renormalized_nodes(mass, step, total_energy[n], potential, workspace[thread_id()], old_ratio[n], new_ratio[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::negative_count(const numerov::RatioBatch &ratio,
+                             Vec<numerov::Workspace> &workspace,
+                             Vec<s64> &node_count)
+{
+	// NOTE: Adds the number of negative eigenvalues of each ratio matrix in a batch
+	// to node_count, which completes the node count of the last grid point.
+
+	assert(node_count.length() == ratio.energy_count());
+
+	u32 team_size = energy_team_size(ratio.energy_count());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= ratio.channel_count());
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < ratio.energy_count(); ++n) {
+			node_count[n] += as_s64(numerov::negative_count(ratio[n], workspace[thread_id()]));
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+static bool is_negligible(usize channel_c,
+                          f64 total_energy,
+                          const Mat<f64> &potential,
+                          const Vec<f64> &threshold,
+                          f64 tolerance,
+                          const numerov::ActiveSet &active,
+                          usize energy_index)
+{
+	// NOTE: Whether channel c is closed, both locally and asymptotically, and weakly
+	// coupled to all active channels other than itself, see renormalized_pruned().
+
+	f64 local_gap = potential(channel_c, channel_c) - total_energy;
+
+	f64 gap = std::min(local_gap, threshold[channel_c] - total_energy);
+
+	if (gap <= 0.0) {
+		return false;
+	}
+
+	for (mut<usize> m = 0; m < active.count(energy_index); ++m) {
+		usize channel_d = active.channel(energy_index, m);
+
+		if ((channel_d != channel_c) && (std::abs(potential(channel_c, channel_d)) > tolerance*gap)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void renormalized_pruned(f64 mass,
+                                f64 step,
+                                f64 total_energy,
+                                const Mat<f64> &potential,
+                                const Vec<f64> &threshold,
+                                f64 tolerance,
+                                numerov::ActiveSet &active,
+                                usize energy_index,
+                                numerov::Workspace &workspace,
+                                Mat<f64> &old_ratio,
+                                Mat<f64> &new_ratio)
+{
+	// NOTE: Same step of the renormalized Numerov algorithm, but only for channels
+	// that are active at this energy. A channel c is removed while it is closed
+	// asymptotically, threshold[c] > E, and weakly coupled to all other active ones,
+	// |V(c, d)| <= tolerance*gap, i.e., its first-order admixture is below the
+	// tolerance. The gap is the smallest of the local, V(c, c) - E = k(c)^2/(2mass),
+	// with k(c) its local wavenumber, and the asymptotic ones, so that channels are
+	// never removed where they are open locally, e.g., inside a well. Removed
+	// channels are propagated as uncoupled ones, with zero off-diagonal ratio
+	// elements, and are tested again at every step: once the criterion fails, e.g.,
+	// when a channel removed deep in the repulsive wall reaches the well, it is
+	// active again, starting from its uncoupled ratio. Thus, no assumption is made
+	// on how couplings vary with R.
+
+	usize channel_count = potential.rows();
+
+	//
+	// Step 1: Bring back the removed channels that are no longer negligible, in
+	// their original order.
+	//
+
+	mut<usize> n = 0;
+
+	for (mut<usize> channel_c = 0; channel_c < channel_count; ++channel_c) {
+		if ((n < active.count(energy_index)) && (active.channel(energy_index, n) == channel_c)) {
+			++n;
+			continue;
+		}
+
+		if (is_negligible(channel_c, total_energy, potential, threshold, tolerance, active, energy_index) == false) {
+			active.insert(energy_index, channel_c);
+			++n;
+		}
+	}
+
+	//
+	// Step 2: Remove the negligibly coupled closed channels, and decouple their
+	// previous ratio from the remaining ones.
+	//
+
+	n = 0;
+
+	while (n < active.count(energy_index)) {
+		usize channel_c = active.channel(energy_index, n);
+
+		if (is_negligible(channel_c, total_energy, potential, threshold, tolerance, active, energy_index)) {
+			for (mut<usize> channel_d = 0; channel_d < channel_count; ++channel_d) {
+				if (channel_d != channel_c) {
+					old_ratio(channel_c, channel_d) = 0.0;
+					old_ratio(channel_d, channel_c) = 0.0;
+				}
+			}
+
+			active.remove(energy_index, n);
+		} else {
+			++n;
+		}
+	}
+
+	usize count = active.count(energy_index);
+
+	if (count == channel_count) {
+		numerov::renormalized(mass, step, total_energy, potential, workspace, old_ratio, new_ratio);
+		return;
+	}
+
+	//
+	// Step 3: Propagate every channel as an uncoupled one, u = (2 + 10t)/(1 - t),
+	// whose ratio is rewritten below for the active ones.
+	//
+
+	f64 fact = -step*step*2.0*mass/12.0;
+
+	new_ratio = 0.0;
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		f64 t = fact*(total_energy - potential(channel, channel));
+
+		f64 r = old_ratio(channel, channel);
+
+		new_ratio(channel, channel) = (2.0 + 10.0*t)/(1.0 - t) - (r != 0.0? 1.0/r : 0.0);
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	//
+	// Step 4: Propagate the active channels, whose potential and ratio matrices
+	// are gathered into (and then scattered from) contiguous submatrices.
+	//
+
+	Mat<f64> sub_potential = workspace.matrix(1, count);
+	Mat<f64> sub_old_ratio = workspace.matrix(2, count);
+	Mat<f64> sub_new_ratio = workspace.matrix(3, count);
+
+	for (mut<usize> a = 0; a < count; ++a) {
+		usize channel_a = active.channel(energy_index, a);
+
+		for (mut<usize> b = 0; b < count; ++b) {
+			usize channel_b = active.channel(energy_index, b);
+
+			sub_potential(a, b) = potential(channel_a, channel_b);
+			sub_old_ratio(a, b) = old_ratio(channel_a, channel_b);
+		}
+	}
+
+	numerov::renormalized(mass, step, total_energy, sub_potential, workspace, sub_old_ratio, sub_new_ratio);
+
+	for (mut<usize> a = 0; a < count; ++a) {
+		usize channel_a = active.channel(energy_index, a);
+
+		for (mut<usize> b = 0; b < count; ++b) {
+			new_ratio(channel_a, active.channel(energy_index, b)) = sub_new_ratio(a, b);
+		}
+	}
+}
+
+void numerov::renormalized(f64 mass,
+                           f64 step,
+                           const Vec<f64> &total_energy,
+                           const Mat<f64> &potential,
+                           const Vec<f64> &threshold,
+                           f64 tolerance,
+                           numerov::ActiveSet &active,
+                           Vec<numerov::Workspace> &workspace,
+                           numerov::RatioBatch &old_ratio,
+                           numerov::RatioBatch &new_ratio)
+{
+	// NOTE: Same as above, but with closed-channel pruning. The threshold (e.g.,
+	// the asymptotic energy) of each channel tells which ones are closed, and the
+	// set of active channels of each energy is updated on exit. Energies are then
+	// scheduled dynamically, since their costs depend on their active channels.
+
+	usize channel_count = potential.rows();
+
+	assert(threshold.length() == channel_count);
+	assert(active.channel_count() == channel_count);
+	assert(active.energy_count() == total_energy.length());
+	assert(old_ratio.channel_count() == channel_count);
+	assert(new_ratio.channel_count() == channel_count);
+	assert(old_ratio.energy_count() == total_energy.length());
+	assert(new_ratio.energy_count() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(dynamic)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			renormalized_pruned(mass, step, total_energy[n], potential, threshold, tolerance, active, n,
+			                    workspace[thread_id()], old_ratio[n], new_ratio[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::renormalized(f64 mass,
+                           f64 step,
+                           const Vec<f64> &total_energy,
+                           const numerov::Eigenbasis &potential,
+                           Vec<numerov::Workspace> &workspace,
+                           numerov::RatioBatch &old_ratio,
+                           numerov::RatioBatch &new_ratio)
+{
+	// NOTE: Same as above, but in the eigenbasis of the coupling potential.
+
+	usize channel_count = potential.value.length();
+
+	assert(old_ratio.channel_count() == channel_count);
+	assert(new_ratio.channel_count() == channel_count);
+	assert(old_ratio.energy_count() == total_energy.length());
+	assert(new_ratio.energy_count() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			numerov::renormalized(mass, step, total_energy[n], potential, workspace[thread_id()], old_ratio[n], new_ratio[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+f64 numerov::step_error(f64 mass,
+                        f64 step,
+                        f64 min_energy,
+                        f64 max_energy,
+                        f64 spacing,
+                        const Mat<f64> &prev_potential,
+                        const Mat<f64> &potential,
+                        const Mat<f64> &next_potential)
+{
+	// NOTE: Estimates the local relative error of one step of the Numerov method,
+	// (h^6/240)|F^(6)/F|, for F'' = -QF with Q = 2mass(EI - V). Its leading terms,
+	// |Q|^3 + |Q||Q''|, are taken from the largest local wavenumber, q = max|Q(c, c)|
+	// over all channels and energies, and from the curvature of the coupling matrix,
+	// given by the finite differences of the potential at three points spaced by
+	// the spacing argument.
+
+	usize channel_count = potential.rows();
+
+	assert(prev_potential.rows() == channel_count);
+	assert(next_potential.rows() == channel_count);
+
+	mut<f64> q = 0.0;
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		f64 v = potential(channel, channel);
+
+		q = std::max(q, 2.0*mass*std::max(std::abs(min_energy - v), std::abs(max_energy - v)));
+	}
+
+	mut<f64> curvature = 0.0;
+
+	for (mut<usize> n = 0; n < channel_count*channel_count; ++n) {
+		f64 diff = next_potential[n] - 2.0*potential[n] + prev_potential[n];
+
+		curvature = std::max(curvature, 2.0*mass*std::abs(diff)/(spacing*spacing));
+	}
+
+	f64 step_6 = step*step*step*step*step*step;
+
+	return step_6*(q*q*q + q*curvature)/240.0;
+}
+
+static void build_numerov_lhs(f64 fact,
+                              f64 total_energy,
+                              const Mat<f64> &potential, Mat<f64> &lhs)
+{
+	// NOTE: Builds the full (I - T) matrix, with T = fact(EI - V).
+
+	usize channel_count = potential.rows();
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		lhs(channel_a, channel_a) = 1.0 - fact*(total_energy - potential(channel_a, channel_a));
+
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			lhs(channel_a, channel_b)
+				= lhs(channel_b, channel_a) = 0.0 - fact*(0.0 - potential(channel_a, channel_b));
+		}
+	}
+}
+
+void numerov::double_step(f64 mass,
+                          f64 step,
+                          f64 total_energy,
+                          const Mat<f64> &past_potential,
+                          const Mat<f64> &potential,
+                          numerov::Workspace &workspace,
+                          Mat<f64> &old_ratio,
+                          Mat<f64> &ratio)
+{
+	// NOTE: Converts the ratio R(n) = F(n + 1)F(n)^-1 of the renormalized Numerov
+	// method, for grid points spaced by a step h, into the ratio R' = F'(n + 1)F'(n
+	// - 1)^-1 of step 2h, so that the propagation can carry on with twice the step.
+	// Since F = (I - T)psi, where T' = 4T for step 2h, it follows that
+	//
+	// R' = A(n + 1)R(n)R(n - 1)A(n - 1)^-1, with A = (I - 4T)(I - T)^-1,
+	//
+	// where past_potential is V(n - 1) and potential is V(n + 1). On entry, ratio
+	// holds R(n) and old_ratio holds R(n - 1)^-1, as left by numerov::renormalized().
+	// On exit, ratio holds R' and old_ratio holds garbage. The product of ratios is
+	// only symmetric up to the truncation error of the method, thus R' is symmetrized.
+
+	usize channel_count = potential.rows();
+
+	assert(past_potential.rows() == channel_count);
+	assert(old_ratio.rows() == channel_count);
+	assert(ratio.rows() == channel_count);
+
+	Mat<f64> lhs = workspace.matrix(0, channel_count);
+	Mat<f64> m1 = workspace.matrix(1, channel_count);
+	Mat<f64> m2 = workspace.matrix(2, channel_count);
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
+
+	f64 fact = -step*step*2.0*mass/12.0;
+
+	//
+	// Step 1: Invert R(n - 1)^-1 back and compute R(n)R(n - 1)(I - T(n - 1)).
+	//
+
+	lapack::sytri(old_ratio, pivot, workspace.work());
+
+	blas::gemm<f64>('n', 'n', ratio, old_ratio, m1);
+
+	build_numerov_lhs(fact, total_energy, past_potential, m2);
+
+	blas::gemm<f64>('n', 'n', m1, m2, ratio);
+
+	//
+	// Step 2: Solve the system of linear equations (I - 4T(n - 1))X' = (ratio)'
+	// for X', i.e., X = (ratio)(I - 4T(n - 1))^-1, using symmetric lhs matrices.
+	//
+
+	build_numerov_lhs(4.0*fact, total_energy, past_potential, lhs);
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			m1(channel_a, channel_b) = ratio(channel_b, channel_a);
+		}
+	}
+
+	lapack::gesv(lhs, pivot, m1);
+
+	//
+	// Step 3: Solve the system of linear equations (I - T(n + 1))Y = X for Y.
+	//
+
+	build_numerov_lhs(fact, total_energy, potential, lhs);
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			m2(channel_a, channel_b) = m1(channel_b, channel_a);
+		}
+	}
+
+	lapack::gesv(lhs, pivot, m2);
+
+	//
+	// Step 4: Compute R' = (I - 4T(n + 1))Y and symmetrize it.
+	//
+
+	build_numerov_lhs(4.0*fact, total_energy, potential, m1);
+
+	blas::gemm<f64>('n', 'n', m1, m2, ratio);
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			ratio(channel_a, channel_b)
+				= ratio(channel_b, channel_a) = 0.5*(ratio(channel_a, channel_b) + ratio(channel_b, channel_a));
+		}
+	}
+}
+
+void numerov::double_step(f64 mass,
+                          f64 step,
+                          const Vec<f64> &total_energy,
+                          const Mat<f64> &past_potential,
+                          const Mat<f64> &potential,
+                          Vec<numerov::Workspace> &workspace,
+                          numerov::RatioBatch &old_ratio,
+                          numerov::RatioBatch &ratio)
+{
+	// NOTE: Same as above, for a batch of ratio matrices, one per total energy.
+
+	usize channel_count = potential.rows();
+
+	assert(old_ratio.channel_count() == channel_count);
+	assert(ratio.channel_count() == channel_count);
+	assert(old_ratio.energy_count() == total_energy.length());
+	assert(ratio.energy_count() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			numerov::double_step(mass, step, total_energy[n], past_potential, potential, workspace[thread_id()], old_ratio[n], ratio[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::log_derivative(f64 mass,
+                             f64 step,
+                             f64 total_energy,
+                             const Mat<f64> &potential,
+                             u32 weight,
+                             numerov::Workspace &workspace,
+                             Mat<f64> &old_y,
+                             Mat<f64> &new_y)
 {
-	return this->entry[mm_index].value[theta_index][energy_index];
-}
+	// NOTE: This routine implements the log-derivative algorithm of Johnson, which
+	// propagates Y = F'/F from a previous grid point to the current one. See Eq. (15)
+	// and (16) of B.R. Johnson. J. Comp. Phys. 13, 445 (1973), also discussed by
+	// D.E. Manolopoulos. J. Chem. Phys. 85, 6425 (1986). With Q = 2mass(EI - V) and
+	// the Simpson weight w of the grid point (see numerov::simpson_weight()):
+	//
+	// Y = (I + hY')^-1 Y' - (h/3)wU,
+	//
+	// where U = Q at even points and U = (I + h^2 Q/6)^-1 Q at odd ones (w = 4).
+	// At the first point, w = 0 and Y is infinite, which is stored as a null matrix.
+	// At even points other than the last (w = 2), Y includes the weight of both
+	// the end of the previous Simpson sector and the beginning of the next one.
+	// On exit, old_y holds garbage.
 
-//
-// Public API:
-//
+	usize channel_count = potential.rows();
 
-void numerov::renormalized(f64 mass,
-                           f64 step,
-                           f64 total_energy,
-                           const Mat<f64> &potential,
-                           Mat<f64> &workspace,
-                           Mat<f64> &old_ratio,
-                           Mat<f64> &new_ratio)
-{
-	// NOTE: This routine implements the renormalized Numerov algorithm of Johnson,
-	// which propagates the ratio of the wavefunction from a previous grid point to
-	// the current one. See Eq. (22) of B.R. Johnson. J. Chem. Phys. 69, 4678 (1978).
-	// Quantities cited below such as T, I, U and R (ratio) are defined in Johnson's
-	// paper.
+	assert(old_y.rows() == channel_count);
+	assert(old_y.cols() == channel_count);
+	assert(new_y.rows() == channel_count);
+	assert(new_y.cols() == channel_count);
 
-	usize channel_count = potential.rows();
+	if (weight == 0) {
+		new_y = 0.0;
+		return;
+	}
 
-	assert(workspace.rows() == channel_count);
-	assert(workspace.cols() == channel_count);
-	assert(old_ratio.rows() == channel_count);
-	assert(old_ratio.cols() == channel_count);
-	assert(new_ratio.rows() == channel_count);
-	assert(new_ratio.cols() == channel_count);
+	Mat<f64> lhs = workspace.matrix(0, channel_count);
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
 
 	//
-	// Step 1: Invert the previous R matrix.
+	// Step 1: Solve the system of linear equations (I + hY')Z = Y' for Z; on exit,
+	// new_y holds Z. When Y' is infinite, Z = I/h.
 	//
 
+	mut<bool> is_null = true;
+
 	for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
-		if (old_ratio[channel] != 0.0) {
-			lapack::sytri(old_ratio);
+		if (old_y[channel] != 0.0) {
+			is_null = false;
 			break;
 		}
 	}
 
+	if (is_null) {
+		new_y = 0.0;
+
+		for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+			new_y(channel, channel) = 1.0/step;
+		}
+	} else {
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+				lhs(channel_a, channel_b) = (channel_a == channel_b? 1.0 : 0.0) + step*old_y(channel_a, channel_b);
+				new_y(channel_a, channel_b) = old_y(channel_a, channel_b);
+			}
+		}
+
+		lapack::gesv(lhs, pivot, new_y);
+	}
+
 	//
-	// Step 2: Build the lhs (I - T) and rhs (2I + 10T) matrices of Eq. (20).
+	// Step 2: Build Q, stored in old_y, and (I + h^2 Q/6) at odd points.
 	//
 
-	f64 fact = -step*step*2.0*mass/12.0;
+	f64 fact = 2.0*mass;
 
 	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
-		f64 T = fact*(total_energy - potential(channel_a, channel_a));
-
-		workspace(channel_a, channel_a) = 1.0 - T;
-		new_ratio(channel_a, channel_a) = 2.0 + 10.0*T;
+		old_y(channel_a, channel_a) = fact*(total_energy - potential(channel_a, channel_a));
 
 		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
-			f64 T = fact*(0.0 - potential(channel_a, channel_b));
-
-			workspace(channel_a, channel_b)
-				= workspace(channel_b, channel_a) = 0.0 - T;
+			old_y(channel_a, channel_b)
+				= old_y(channel_b, channel_a) = fact*(0.0 - potential(channel_a, channel_b));
+		}
+	}
 
-			new_ratio(channel_a, channel_b)
-				= new_ratio(channel_b, channel_a) = 0.0 + 10.0*T;
+	if (weight == 4) {
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+				lhs(channel_a, channel_b) = (channel_a == channel_b? 1.0 : 0.0) + step*step*old_y(channel_a, channel_b)/6.0;
+			}
 		}
+
+		//
+		// Step 3: Solve the system of linear equations (I + h^2 Q/6)U = Q for U;
+		// on exit, old_y holds U.
+		//
+
+		lapack::gesv(lhs, pivot, old_y);
 	}
 
 	//
-	// Step 3: Solve the system of linear equations (I - T)U = (2I + 10T) for U;
-	// on exit, new_ratio holds U temporarily.
+	// Step 4: Solve Eq. (15) for Y = Z - (h/3)wU.
 	//
 
-	lapack::gesv(workspace, new_ratio);
+	f64 w = step*as_f64(weight)/3.0;
 
-	//
-	// Step 4: Solve Eq. (22) for R = U - R'.
-	//
+	for (mut<usize> channel = 0; channel < channel_count*channel_count; ++channel) {
+		new_y[channel] -= w*old_y[channel];
+	}
+}
 
-	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
-		new_ratio(channel_a, channel_a) -= old_ratio(channel_a, channel_a);
+void numerov::log_derivative(f64 mass,
+                             f64 step,
+                             const Vec<f64> &total_energy,
+                             const Mat<f64> &potential,
+                             u32 weight,
+                             Vec<numerov::Workspace> &workspace,
+                             numerov::RatioBatch &old_y,
+                             numerov::RatioBatch &new_y)
+{
+	// NOTE: Advances a batch of log-derivative matrices, one per total energy, by
+	// a single grid step, as in the batched Numerov routines above.
 
-		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
-			new_ratio(channel_a, channel_b) -= old_ratio(channel_a, channel_b);
-			new_ratio(channel_b, channel_a) -= old_ratio(channel_b, channel_a);
+	usize channel_count = potential.rows();
+
+	assert(old_y.channel_count() == channel_count);
+	assert(new_y.channel_count() == channel_count);
+	assert(old_y.energy_count() == total_energy.length());
+	assert(new_y.energy_count() == total_energy.length());
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(static)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			numerov::log_derivative(mass, step, total_energy[n], potential, weight, workspace[thread_id()], old_y[n], new_y[n]);
 		}
+
+		blas::set_local_thread_count(0);
 	}
 }
 
-usize numerov::build_react_matrix(f64 mass,
-                                  f64 step,
-                                  f64 R_max,
-                                  f64 total_energy,
-                                  const Mat<f64> &ratio,
-                                  const numerov::Basis &level, Mat<f64> &k)
+static usize build_asymptotic_terms(f64 mass,
+                                    f64 step,
+                                    f64 R_max,
+                                    f64 total_energy,
+                                    const numerov::Basis &level,
+                                    Vec<f64> &j, Vec<f64> &n, Vec<f64> &rj, Vec<f64> &rn)
 {
-	// NOTE: This routine implements Johnson's algorithm to compute the augmented
-	// reaction matrix K, as in B.R. Johnson. J. Chem. Phys. 69, 4678 (1978). See
-	// Appendix A, Eq. (A19). The products Rn and Rj in the paper are named rn and
-	// rj below, where R is the ratio of the wavefunction at R_max.
+	// NOTE: Builds the diagonal Riccati-Bessel matrices of Johnson, J. Chem. Phys.
+	// 69, 4678 (1978), using Eq. (A16), (A17) and (A20-23), and returns the number
+	// of open channels. Only their diagonals are stored. Closed channels
+	// use the modified spherical Bessel functions, normalized to one at R_max, and
+	// only their ratios between R_inf and R_max are computed, with the exponential
+	// factors of the scaled functions recombined to avoid overflows.
 
-	usize channel_count = ratio.rows();
-
-	assert(k.rows() == channel_count);
-	assert(k.cols() == channel_count);
-	assert(level.list.length() == channel_count);
+	usize channel_count = level.list.length();
 
 	mut<usize> count = 0;
 
@@ -542,76 +2183,236 @@ usize numerov::build_react_matrix(f64 mass,
 	// NOTE: Eq. (17) combined with Eq. (2).
 	f64 fact = -step*step*2.0*mass/12.0;
 
-	Mat<f64> n(channel_count, channel_count), j(channel_count, channel_count);
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		f64 l = as_f64(level.list[channel].l);
+
+		f64 eigenval = level.list[channel].eigenval;
+
+		f64 T_max = fact*(total_energy - (eigenval + numerov::centrifugal_term(l, mass, R_max)));
+
+		f64 T_inf = fact*(total_energy - (eigenval + numerov::centrifugal_term(l, mass, R_inf)));
+
+		if (eigenval < total_energy) {
+			++count;
+
+			f64 wavenum = numerov::wavenumber(mass, total_energy, eigenval);
+
+			f64 x_max = wavenum*R_max;
+			f64 x_inf = wavenum*R_inf;
+
+			n[channel] = (1.0 - T_max)*math::riccati_bessel('n', l, x_max);
+			j[channel] = (1.0 - T_max)*math::riccati_bessel('j', l, x_max);
+
+			rn[channel] = (1.0 - T_inf)*math::riccati_bessel('n', l, x_inf);
+			rj[channel] = (1.0 - T_inf)*math::riccati_bessel('j', l, x_inf);
+		} else {
+			u32 order = as_u32(level.list[channel].l);
+
+			f64 wavenum = std::sqrt(2.0*mass*(eigenval - total_energy));
+
+			f64 x_max = wavenum*R_max;
+			f64 x_inf = wavenum*R_inf;
+
+			f64 ratio = (1.0 - T_inf)*x_inf/((1.0 - T_max)*x_max);
+
+			n[channel] = 1.0;
+			j[channel] = 1.0;
+
+			rn[channel] = ratio*std::exp(x_max - x_inf)
+			            *math::sphe_bessel('k', order, x_inf)/math::sphe_bessel('k', order, x_max);
+
+			rj[channel] = ratio*std::exp(x_inf - x_max)
+			            *math::sphe_bessel('i', order, x_inf)/math::sphe_bessel('i', order, x_max);
+		}
+	}
 
-	Mat<f64> rn(channel_count, channel_count), rj(channel_count, channel_count);
+	return count;
+}
 
+usize numerov::build_ratio_matrix(f64 mass,
+                                  f64 step,
+                                  f64 R_max,
+                                  f64 total_energy,
+                                  const Mat<f64> &y,
+                                  const numerov::Basis &level,
+                                  numerov::Workspace &workspace, Mat<f64> &ratio)
+{
+	// NOTE: This routine converts the log-derivative matrix Y at R_max into the
+	// ratio matrix of the renormalized Numerov method between R_max and R_max +
+	// step that yields the same augmented reaction matrix K, so that solutions of
+	// both methods share the same file format and numerov::build_react_matrix().
+	// First, Y is matched to the asymptotic wavefunction F = J + NK, with F' = YF:
 	//
-	// Step 1: Build the diagonal Riccati-Bessel matrices using Eq. (A16), (A17)
-	// and (A20-23).
+	// (YN - N')K = J' - YJ.
 	//
+	// Then, using the diagonal matrices of numerov::build_react_matrix(), the
+	// ratio follows from R(j + nK) = (rj + rnK). Returns the open channel count.
 
-	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
-		f64 l = as_f64(level.list[channel].l);
+	usize channel_count = y.rows();
 
-		f64 T_max = fact*(
-			total_energy - (level.list[channel].eigenval + numerov::centrifugal_term(l, mass, R_max))
-		);
+	assert(y.cols() == channel_count);
+	assert(ratio.rows() == channel_count);
+	assert(ratio.cols() == channel_count);
+	assert(level.list.length() == channel_count);
 
-		f64 T_inf = fact*(
-			total_energy - (level.list[channel].eigenval + numerov::centrifugal_term(l, mass, R_inf))
-		);
+	Mat<f64> a = workspace.matrix(0, channel_count);
+	Mat<f64> k = workspace.matrix(1, channel_count);
 
-		f64 wavenum = numerov::wavenumber(mass, total_energy, level.list[channel].eigenval);
+	Vec<s32> pivot = workspace.pivot(channel_count);
 
-		f64 x_max = wavenum*R_max;
+	//
+	// Step 1: Build the (YN - N') and (J' - YJ) matrices, with J and N in terms of
+	// the Riccati-Bessel functions for open channels, or of the modified spherical
+	// Bessel functions (normalized to one at R_max) for closed ones.
+	//
 
-		f64 x_inf = wavenum*R_inf;
+	for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+		f64 l = as_f64(level.list[channel_b].l);
 
-		if (level.list[channel].eigenval < total_energy) {
-			++count;
+		f64 eigenval = level.list[channel_b].eigenval;
 
-			n(channel, channel) = (1.0 - T_max)*math::riccati_bessel('n', l, x_max);
-			j(channel, channel) = (1.0 - T_max)*math::riccati_bessel('j', l, x_max);
+		mut<f64> f_j = 1.0, df_j = 0.0, f_n = 1.0, df_n = 0.0;
 
-			rn(channel, channel) = (1.0 - T_inf)*math::riccati_bessel('n', l, x_inf);
-			rj(channel, channel) = (1.0 - T_inf)*math::riccati_bessel('j', l, x_inf);
+		if (eigenval < total_energy) {
+			f64 wavenum = numerov::wavenumber(mass, total_energy, eigenval);
+
+			f64 x = wavenum*R_max;
+
+			// NOTE: f'(x) = (l + 1)f(x)/x - f(x; l + 1), for f = j or n.
+			f_j = math::riccati_bessel('j', l, x);
+			f_n = math::riccati_bessel('n', l, x);
+
+			df_j = wavenum*((l + 1.0)*f_j/x - math::riccati_bessel('j', l + 1.0, x));
+			df_n = wavenum*((l + 1.0)*f_n/x - math::riccati_bessel('n', l + 1.0, x));
 		} else {
-			n(channel, channel) = 1.0;
-			j(channel, channel) = 1.0;
+			u32 order = as_u32(level.list[channel_b].l);
+
+			f64 wavenum = std::sqrt(2.0*mass*(eigenval - total_energy));
+
+			f64 x = wavenum*R_max;
+
+			// NOTE: (xi)'/(xi) = (l + 1)/x + i(x; l + 1)/i(x) and (xk)'/(xk) = (l + 1)/x
+			// - k(x; l + 1)/k(x). The ratios of scaled functions are the same.
+			df_j = wavenum*((l + 1.0)/x + math::sphe_bessel('i', order + 1, x)/math::sphe_bessel('i', order, x));
+			df_n = wavenum*((l + 1.0)/x - math::sphe_bessel('k', order + 1, x)/math::sphe_bessel('k', order, x));
+		}
+
+		for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+			a(channel_a, channel_b) = y(channel_a, channel_b)*f_n;
+			k(channel_a, channel_b) = -y(channel_a, channel_b)*f_j;
+		}
+
+		a(channel_b, channel_b) -= df_n;
+		k(channel_b, channel_b) += df_j;
+	}
+
+	//
+	// Step 2: Solve the system of linear equations (YN - N')K = (J' - YJ) for K.
+	//
+
+	lapack::gesv(a, pivot, k);
+
+	//
+	// Step 3: Build the transposes of (j + nK) and (rj + rnK), using a and ratio.
+	//
 
-			rn(channel, channel) = (1.0 - T_inf)*math::riccati_bessel('n', l, x_inf)/
-			             (1.0 - T_max)*math::riccati_bessel('n', l, x_max);
+	Vec<f64> j = workspace.diagonal(0, channel_count);
+	Vec<f64> n = workspace.diagonal(1, channel_count);
+	Vec<f64> rj = workspace.diagonal(2, channel_count);
+	Vec<f64> rn = workspace.diagonal(3, channel_count);
 
-			rj(channel, channel) = (1.0 - T_inf)*math::riccati_bessel('j', l, x_inf)/
-			             (1.0 - T_max)*math::riccati_bessel('j', l, x_max);
+	usize count = build_asymptotic_terms(mass, step, R_max, total_energy, level, j, n, rj, rn);
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			a(channel_b, channel_a) = n[channel_a]*k(channel_a, channel_b);
+			ratio(channel_b, channel_a) = rn[channel_a]*k(channel_a, channel_b);
 		}
+
+		a(channel_a, channel_a) += j[channel_a];
+		ratio(channel_a, channel_a) += rj[channel_a];
 	}
 
 	//
-	// Step 2: Compute the (-rn + n) matrix.
+	// Step 4: Solve the system of linear equations (j + nK)'R' = (rj + rnK)' for R'
+	// and transpose the result.
 	//
 
-	blas::gemm<f64>('n', 'n', ratio, n, rn, -1.0, 1.0);
+	lapack::gesv(a, pivot, ratio);
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = (channel_a + 1); channel_b < channel_count; ++channel_b) {
+			f64 value = ratio(channel_a, channel_b);
+
+			ratio(channel_a, channel_b) = ratio(channel_b, channel_a);
+			ratio(channel_b, channel_a) = value;
+		}
+	}
+
+	return count;
+}
+
+usize numerov::build_react_matrix(f64 mass,
+                                  f64 step,
+                                  f64 R_max,
+                                  f64 total_energy,
+                                  const Mat<f64> &ratio,
+                                  const numerov::Basis &level,
+                                  numerov::Workspace &workspace, Mat<f64> &k)
+{
+	// NOTE: This routine implements Johnson's algorithm to compute the augmented
+	// reaction matrix K, as in B.R. Johnson. J. Chem. Phys. 69, 4678 (1978). See
+	// Appendix A, Eq. (A19). The products Rn and Rj in the paper are named rn and
+	// rj below, where R is the ratio of the wavefunction at R_max.
+
+	usize channel_count = ratio.rows();
+
+	assert(k.rows() == channel_count);
+	assert(k.cols() == channel_count);
+	assert(level.list.length() == channel_count);
+
+	Vec<f64> j = workspace.diagonal(0, channel_count);
+	Vec<f64> n = workspace.diagonal(1, channel_count);
+	Vec<f64> rj = workspace.diagonal(2, channel_count);
+	Vec<f64> rn = workspace.diagonal(3, channel_count);
+
+	Mat<f64> lhs = workspace.matrix(0, channel_count);
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
 
 	//
-	// Step 3: Compute the (rj - j) matrix.
+	// Step 1: Build the diagonal Riccati-Bessel matrices using Eq. (A16), (A17)
+	// and (A20-23).
 	//
 
-	blas::gemm<f64>('n', 'n', ratio, j, rj, 1.0, -1.0);
+	usize count = build_asymptotic_terms(mass, step, R_max, total_energy, level, j, n, rj, rn);
 
 	//
-	// Step 4: Solve the system of linear equations (-rn + n)K = (rj - j) for K.
+	// Step 2: Compute the (-rn + n) and (rj - j) matrices, with rn and rj on the
+	// rhs standing for the products of R and the diagonal n and j matrices.
 	//
 
-	lapack::gesv(rn, rj);
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			lhs(channel_a, channel_b) = -ratio(channel_a, channel_b)*n[channel_b];
+			k(channel_a, channel_b) = ratio(channel_a, channel_b)*j[channel_b];
+		}
+
+		lhs(channel_a, channel_a) += rn[channel_a];
+		k(channel_a, channel_a) -= rj[channel_a];
+	}
+
+	//
+	// Step 3: Solve the system of linear equations (-rn + n)K = (rj - j) for K.
+	//
 
-	k.swap(rj);
+	lapack::gesv(lhs, pivot, k);
 
 	return count;
 }
 
 void numerov::build_scatt_matrix(const Mat<f64> &k,
+                                 numerov::Workspace &workspace,
                                  Mat<f64> &re_s, Mat<f64> &im_s)
 {
 	// NOTE: This routine computes the scatt. matrix S from the open-open block of
@@ -629,16 +2430,18 @@ void numerov::build_scatt_matrix(const Mat<f64> &k,
 	// Step 1: Compute the square of the K matrix.
 	//
 
-	Mat<f64> workspace(channel_count, channel_count);
+	Mat<f64> lhs = workspace.matrix(0, channel_count);
+
+	Vec<s32> pivot = workspace.pivot(channel_count);
 
-	blas::gemm<f64>('n', 'n', k, k, workspace);
+	blas::gemm<f64>('n', 'n', k, k, lhs);
 
 	//
 	// Step 2: Build the (I + K^2) and 2K matrices with re(S) = I temporarily.
 	//
 
 	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
-		workspace(channel_a, channel_a) += 1.0;
+		lhs(channel_a, channel_a) += 1.0;
 
 		re_s(channel_a, channel_a) = 1.0;
 		im_s(channel_a, channel_a) = 2.0*k(channel_a, channel_a);
@@ -656,7 +2459,7 @@ void numerov::build_scatt_matrix(const Mat<f64> &k,
 	// Step 3: Solve the system of linear equations (I + K^2)im(S) = 2K for im(S).
 	//
 
-	lapack::gesv(workspace, im_s);
+	lapack::gesv(lhs, pivot, im_s);
 
 	//
 	// Step 4: Solve re(S) = I - (K)im(S) = -I + (K)im(S).
@@ -665,6 +2468,210 @@ void numerov::build_scatt_matrix(const Mat<f64> &k,
 	blas::gemm<f64>('n', 'n', k, im_s, re_s, 1.0, -1.0);
 }
 
+static void scatt_matrix_from_react(f64 total_energy,
+                                    const Mat<f64> &k,
+                                    const numerov::Basis &level,
+                                    numerov::Workspace &workspace, Mat<f64> &re_s, Mat<f64> &im_s)
+{
+	// NOTE: Builds the full S-matrix, with zeros for closed channels, from the full
+	// reaction matrix K of a given total energy. K may be the scratch matrix 1 of
+	// the workspace, which is only reused after the open-open block is gathered.
+
+	usize channel_count = k.rows();
+
+	mut<usize> open_count = 0;
+
+	for (mut<usize> channel = 0; channel < channel_count; ++channel) {
+		if (level.list[channel].eigenval < total_energy) {
+			++open_count;
+		}
+	}
+
+	re_s = 0.0;
+	im_s = 0.0;
+
+	if (open_count == 0) {
+		return;
+	}
+
+	//
+	// Step 1: Gather the open-open block of K.
+	//
+
+	Mat<f64> open_k = workspace.matrix(2, open_count);
+
+	mut<usize> a = 0;
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		if (level.list[channel_a].eigenval >= total_energy) {
+			continue;
+		}
+
+		mut<usize> b = 0;
+
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			if (level.list[channel_b].eigenval < total_energy) {
+				open_k(a, b) = k(channel_a, channel_b);
+				++b;
+			}
+		}
+
+		++a;
+	}
+
+	//
+	// Step 2: Compute S and scatter it back to the full matrices. The full K is
+	// no longer needed, thus its scratch matrix is reused for im(S).
+	//
+
+	Mat<f64> open_re_s = workspace.matrix(3, open_count);
+	Mat<f64> open_im_s = workspace.matrix(1, open_count);
+
+	numerov::build_scatt_matrix(open_k, workspace, open_re_s, open_im_s);
+
+	a = 0;
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		if (level.list[channel_a].eigenval >= total_energy) {
+			continue;
+		}
+
+		mut<usize> b = 0;
+
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			if (level.list[channel_b].eigenval < total_energy) {
+				re_s(channel_a, channel_b) = open_re_s(a, b);
+				im_s(channel_a, channel_b) = open_im_s(a, b);
+				++b;
+			}
+		}
+
+		++a;
+	}
+}
+
+void numerov::build_scatt_matrix(f64 mass,
+                                 f64 step,
+                                 f64 R_max,
+                                 const Vec<f64> &total_energy,
+                                 const numerov::RatioBatch &ratio,
+                                 const numerov::Basis &level,
+                                 Vec<numerov::Workspace> &workspace,
+                                 numerov::RatioBatch &re_s, numerov::RatioBatch &im_s)
+{
+	// NOTE: Builds the S-matrix of a batch of ratio matrices at R_max, one per total
+	// energy, as in numerov::build_react_matrix() and numerov::build_scatt_matrix()
+	// above. The full S-matrices are returned, with zeros for closed channels, thus
+	// the open ones need not be the first channels of the basis set.
+
+	usize channel_count = ratio.channel_count();
+
+	assert(re_s.channel_count() == channel_count);
+	assert(im_s.channel_count() == channel_count);
+	assert(ratio.energy_count() == total_energy.length());
+	assert(re_s.energy_count() == total_energy.length());
+	assert(im_s.energy_count() == total_energy.length());
+	assert(level.list.length() == channel_count);
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(dynamic)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			auto &thread_workspace = workspace[thread_id()];
+
+			Mat<f64> k = thread_workspace.matrix(1, channel_count);
+
+			numerov::build_react_matrix(mass, step, R_max, total_energy[n], ratio[n], level, thread_workspace, k);
+
+			scatt_matrix_from_react(total_energy[n], k, level, thread_workspace, re_s[n], im_s[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::build_react_matrix(f64 mass,
+                                 f64 step,
+                                 f64 R_max,
+                                 const Vec<f64> &total_energy,
+                                 const numerov::RatioBatch &ratio,
+                                 const numerov::Basis &level,
+                                 Vec<numerov::Workspace> &workspace, numerov::RatioBatch &k)
+{
+	// NOTE: Builds the full reaction matrices of a batch of ratio matrices at R_max,
+	// one per total energy, as in numerov::build_react_matrix() above.
+
+	usize channel_count = ratio.channel_count();
+
+	assert(k.channel_count() == channel_count);
+	assert(ratio.energy_count() == total_energy.length());
+	assert(k.energy_count() == total_energy.length());
+	assert(level.list.length() == channel_count);
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(dynamic)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			numerov::build_react_matrix(mass, step, R_max, total_energy[n], ratio[n], level, workspace[thread_id()], k[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
+void numerov::build_scatt_matrix(const Vec<f64> &total_energy,
+                                 const numerov::RatioBatch &k,
+                                 const numerov::Basis &level,
+                                 Vec<numerov::Workspace> &workspace,
+                                 numerov::RatioBatch &re_s, numerov::RatioBatch &im_s)
+{
+	// NOTE: Builds the full S-matrices of a batch of reaction matrices, one per total
+	// energy, e.g., those kept from an earlier matching radius.
+
+	usize channel_count = k.channel_count();
+
+	assert(re_s.channel_count() == channel_count);
+	assert(im_s.channel_count() == channel_count);
+	assert(k.energy_count() == total_energy.length());
+	assert(re_s.energy_count() == total_energy.length());
+	assert(im_s.energy_count() == total_energy.length());
+	assert(level.list.length() == channel_count);
+
+	u32 team_size = energy_team_size(total_energy.length());
+	u32 backend_size = max_thread_count()/team_size;
+
+	#pragma omp parallel default(shared) num_threads(team_size)
+	{
+		assert(workspace.length() >= thread_count());
+		assert(workspace[thread_id()].channel_count() >= channel_count);
+
+		blas::set_local_thread_count(backend_size);
+
+		#pragma omp for schedule(dynamic)
+		for (mut<usize> n = 0; n < total_energy.length(); ++n) {
+			scatt_matrix_from_react(total_energy[n], k[n], level, workspace[thread_id()], re_s[n], im_s[n]);
+		}
+
+		blas::set_local_thread_count(0);
+	}
+}
+
 void numerov::build_scatt_amplitude(const numerov::ScattMatrixEntry &s,
                                     s32 m_in, s32 m_out, f64 theta, f64 phi, Vec<c64> &f)
 {
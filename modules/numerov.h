@@ -2,11 +2,16 @@
 
 #include "essentials.h"
 #include "fgh.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace numerov {
 	// NOTE: The first file format is intended for input coupling potentials,
 	// the second for output Numerov ratio matrices and the third for S-matrices.
-	constexpr u8 FORMAT_VERSION = 3;
+	// The fourth is that of coupling potentials with their block structure,
+	// and the fifth that of ratio matrices with their matching radius.
+	constexpr u8 FORMAT_VERSION = 5;
 
 	constexpr u32 MAGIC_NUMBER = 1701998454u;
 
@@ -15,6 +20,8 @@ namespace numerov {
 		Vec<fgh::BasisEntry> list;
 
 		Basis(String &filename);
+
+		Basis(usize channel_count);
 	};
 
 	struct PotentialEntry {
@@ -27,7 +34,7 @@ namespace numerov {
 
 	class Potential {
 		public:
-		Potential(c_str filename, u8 fmt_ver = 1);
+		Potential(c_str filename, u8 fmt_ver = 4);
 
 		c_str filename() const;
 
@@ -39,9 +46,56 @@ namespace numerov {
 
 		const PotentialEntry& operator[](usize grid_index);
 
+		usize block_count() const;
+
+		usize block_size(usize block_index) const;
+
+		usize block_channel(usize block_index, usize n) const;
+
+		void copy_block(usize block_index, const Mat<f64> &value, Mat<f64> &block) const;
+
 		private:
 		file::Input input;
 		PotentialEntry entry;
+		Vec<usize> block_list;
+		Vec<usize> block_start;
+
+		void read_blocks();
+	};
+
+	class PotentialStream {
+		public:
+		PotentialStream(const numerov::Potential &coupling, usize window);
+
+		PotentialStream(const PotentialStream &other) = delete;
+
+		usize window() const;
+
+		void request(usize grid_index);
+
+		const Mat<f64>& operator[](usize grid_index);
+
+		~PotentialStream();
+
+		private:
+		file::Input input;
+		Vec<f64> stack;
+		Vec<Mat<f64>> value;
+		Vec<usize> index;
+		Vec<u8> state;
+		mut<bool> is_closed;
+		std::mutex lock;
+		std::condition_variable changed;
+		std::thread reader;
+
+		void read_loop();
+	};
+
+	struct Eigenbasis {
+		Vec<f64> value;
+		Mat<f64> vector;
+
+		Eigenbasis(usize channel_count);
 	};
 
 	struct RatioEntry {
@@ -56,7 +110,7 @@ namespace numerov {
 
 	class Ratio {
 		public:
-		Ratio(c_str filename, u8 fmt_ver = 2);
+		Ratio(c_str filename, u8 fmt_ver = 5);
 
 		c_str filename() const;
 
@@ -68,14 +122,91 @@ namespace numerov {
 
 		Range<f64> energy_range();
 
-		const RatioEntry& operator()(usize grid_index, usize energy_index);
+		f64 match_radius();
+
+		const RatioEntry& operator()(usize energy_index);
 
 		private:
-		mut<usize> stride;
+		mut<usize> energy_count;
 		file::Input input;
 		RatioEntry entry;
 	};
 
+	class Workspace {
+		public:
+		Workspace(usize channel_count, bool use_single_precision = false);
+
+		usize channel_count() const;
+
+		Mat<f64> matrix(usize index, usize channel_count);
+
+		Vec<f64> diagonal(usize index, usize channel_count);
+
+		Vec<s32> pivot(usize channel_count);
+
+		Vec<f64>& work();
+
+		Mat<f32> single_matrix(usize index, usize channel_count);
+
+		Vec<f32>& single_work();
+
+		void swap(Workspace &other);
+
+		private:
+		mut<usize> max_channel_count;
+		Vec<f64> stack;
+		Vec<s32> ipiv;
+		Vec<f64> lapack_work;
+		Vec<f32> single_stack;
+		Vec<f32> single_lapack_work;
+	};
+
+	class ActiveSet {
+		public:
+		ActiveSet(usize channel_count, usize energy_count);
+
+		usize channel_count() const;
+
+		usize energy_count() const;
+
+		usize count(usize energy_index) const;
+
+		usize channel(usize energy_index, usize n) const;
+
+		void remove(usize energy_index, usize n);
+
+		void insert(usize energy_index, usize channel);
+
+		void swap(ActiveSet &other);
+
+		private:
+		Vec<usize> active_count;
+		Mat<usize> active_list;
+	};
+
+	class RatioBatch {
+		public:
+		RatioBatch(usize channel_count, usize energy_count);
+
+		RatioBatch(RatioBatch &batch, usize first_energy, usize last_energy);
+
+		usize channel_count() const;
+
+		usize energy_count() const;
+
+		usize stride() const;
+
+		Mat<f64>& operator[](usize energy_index) const;
+
+		void swap(RatioBatch &other);
+
+		private:
+		mut<usize> offset;
+		mut<usize> padded_size;
+		Vec<f64> stack;
+		Vec<Mat<f64>> entry;
+	};
+
 	struct ScattMatrixEntry {
 		mut<usize> size;
 		mut<usize> channel_count;
@@ -155,20 +286,185 @@ namespace numerov {
 	                  f64 step,
 	                  f64 total_energy,
 	                  const Mat<f64> &potential,
-	                  Mat<f64> &workspace,
+	                  numerov::Workspace &workspace,
+	                  Mat<f64> &old_ratio,
+	                  Mat<f64> &new_ratio);
+
+	void renormalized_mixed(f64 mass,
+	                        f64 step,
+	                        f64 total_energy,
+	                        const Mat<f64> &potential,
+	                        numerov::Workspace &workspace,
+	                        Mat<f64> &old_ratio,
+	                        Mat<f64> &new_ratio);
+
+	f64 renormalized_checked(f64 mass,
+	                         f64 step,
+	                         f64 total_energy,
+	                         const Mat<f64> &potential,
+	                         numerov::Workspace &workspace,
+	                         Mat<f64> &old_ratio,
+	                         Mat<f64> &new_ratio);
+
+	s64 renormalized_nodes(f64 mass,
+	                       f64 step,
+	                       f64 total_energy,
+	                       const Mat<f64> &potential,
+	                       numerov::Workspace &workspace,
+	                       Mat<f64> &old_ratio,
+	                       Mat<f64> &new_ratio);
+
+	usize negative_count(const Mat<f64> &ratio, numerov::Workspace &workspace);
+
+	void build_eigenbasis(const Mat<f64> &potential, numerov::Workspace &workspace, numerov::Eigenbasis &eigen);
+
+	void renormalized(f64 mass,
+	                  f64 step,
+	                  f64 total_energy,
+	                  const numerov::Eigenbasis &potential,
+	                  numerov::Workspace &workspace,
 	                  Mat<f64> &old_ratio,
 	                  Mat<f64> &new_ratio);
 
+	void renormalized(f64 mass,
+	                  f64 step,
+	                  const Vec<f64> &total_energy,
+	                  const Mat<f64> &potential,
+	                  Vec<numerov::Workspace> &workspace,
+	                  numerov::RatioBatch &old_ratio,
+	                  numerov::RatioBatch &new_ratio);
+
+	void renormalized(f64 mass,
+	                  f64 step,
+	                  const Vec<f64> &total_energy,
+	                  const Mat<f64> &potential,
+	                  const Vec<f64> &threshold,
+	                  f64 tolerance,
+	                  numerov::ActiveSet &active,
+	                  Vec<numerov::Workspace> &workspace,
+	                  numerov::RatioBatch &old_ratio,
+	                  numerov::RatioBatch &new_ratio);
+
+	void renormalized_mixed(f64 mass,
+	                        f64 step,
+	                        const Vec<f64> &total_energy,
+	                        const Mat<f64> &potential,
+	                        f64 tolerance,
+	                        bool is_checked,
+	                        Vec<f64> &deviation,
+	                        Vec<numerov::Workspace> &workspace,
+	                        numerov::RatioBatch &old_ratio,
+	                        numerov::RatioBatch &new_ratio);
+
+	void renormalized_nodes(f64 mass,
+	                        f64 step,
+	                        const Vec<f64> &total_energy,
+	                        const Mat<f64> &potential,
+	                        Vec<numerov::Workspace> &workspace,
+	                        numerov::RatioBatch &old_ratio,
+	                        numerov::RatioBatch &new_ratio,
+	                        Vec<s64> &node_count);
+
+	void negative_count(const numerov::RatioBatch &ratio,
+	                    Vec<numerov::Workspace> &workspace,
+	                    Vec<s64> &node_count);
+
+	void renormalized(f64 mass,
+	                  f64 step,
+	                  const Vec<f64> &total_energy,
+	                  const numerov::Eigenbasis &potential,
+	                  Vec<numerov::Workspace> &workspace,
+	                  numerov::RatioBatch &old_ratio,
+	                  numerov::RatioBatch &new_ratio);
+
+	f64 step_error(f64 mass,
+	               f64 step,
+	               f64 min_energy,
+	               f64 max_energy,
+	               f64 spacing,
+	               const Mat<f64> &prev_potential,
+	               const Mat<f64> &potential,
+	               const Mat<f64> &next_potential);
+
+	void double_step(f64 mass,
+	                 f64 step,
+	                 f64 total_energy,
+	                 const Mat<f64> &past_potential,
+	                 const Mat<f64> &potential,
+	                 numerov::Workspace &workspace,
+	                 Mat<f64> &old_ratio,
+	                 Mat<f64> &ratio);
+
+	void double_step(f64 mass,
+	                 f64 step,
+	                 const Vec<f64> &total_energy,
+	                 const Mat<f64> &past_potential,
+	                 const Mat<f64> &potential,
+	                 Vec<numerov::Workspace> &workspace,
+	                 numerov::RatioBatch &old_ratio,
+	                 numerov::RatioBatch &ratio);
+
+	void log_derivative(f64 mass,
+	                    f64 step,
+	                    f64 total_energy,
+	                    const Mat<f64> &potential,
+	                    u32 weight,
+	                    numerov::Workspace &workspace,
+	                    Mat<f64> &old_y,
+	                    Mat<f64> &new_y);
+
+	void log_derivative(f64 mass,
+	                    f64 step,
+	                    const Vec<f64> &total_energy,
+	                    const Mat<f64> &potential,
+	                    u32 weight,
+	                    Vec<numerov::Workspace> &workspace,
+	                    numerov::RatioBatch &old_y,
+	                    numerov::RatioBatch &new_y);
+
+	usize build_ratio_matrix(f64 mass,
+	                         f64 step,
+	                         f64 R_max,
+	                         f64 total_energy,
+	                         const Mat<f64> &y,
+	                         const numerov::Basis &level,
+	                         numerov::Workspace &workspace, Mat<f64> &ratio);
+
 	usize build_react_matrix(f64 mass,
 	                         f64 step,
 	                         f64 R_max,
 	                         f64 total_energy,
 	                         const Mat<f64> &ratio,
-	                         const numerov::Basis &level, Mat<f64> &k);
+	                         const numerov::Basis &level,
+	                         numerov::Workspace &workspace, Mat<f64> &k);
 
 	void build_scatt_matrix(const Mat<f64> &k,
+	                        numerov::Workspace &workspace,
 	                        Mat<f64> &re_s, Mat<f64> &im_s);
 
+	void build_scatt_matrix(f64 mass,
+	                        f64 step,
+	                        f64 R_max,
+	                        const Vec<f64> &total_energy,
+	                        const numerov::RatioBatch &ratio,
+	                        const numerov::Basis &level,
+	                        Vec<numerov::Workspace> &workspace,
+	                        numerov::RatioBatch &re_s, numerov::RatioBatch &im_s);
+
+	void build_react_matrix(f64 mass,
+	                        f64 step,
+	                        f64 R_max,
+	                        const Vec<f64> &total_energy,
+	                        const numerov::RatioBatch &ratio,
+	                        const numerov::Basis &level,
+	                        Vec<numerov::Workspace> &workspace, numerov::RatioBatch &k);
+
+	void build_scatt_matrix(const Vec<f64> &total_energy,
+	                        const numerov::RatioBatch &k,
+	                        const numerov::Basis &level,
+	                        Vec<numerov::Workspace> &workspace,
+	                        numerov::RatioBatch &re_s, numerov::RatioBatch &im_s);
+
 	void build_scatt_amplitude(const ScattMatrixEntry &s,
 	                           s32 m_in, s32 m_out, f64 theta, f64 phi, Vec<c64> &f);
 
@@ -190,4 +486,21 @@ namespace numerov {
 	{
 		return std::sqrt(2.0*mass*(total_energy - eigenval));
 	}
+
+	inline static u32 simpson_weight(usize grid_index, usize grid_count)
+	{
+		// NOTE: Weights of the log-derivative method for each grid point. Simpson's
+		// rule needs an even number of intervals, thus the first point is skipped
+		// otherwise. A weight of zero marks where the wavefunction is zero.
+
+		usize first = (grid_count - 1)%2;
+
+		if (grid_index <= first) {
+			return 0;
+		} else if (grid_index == (grid_count - 1)) {
+			return 1;
+		} else {
+			return (((grid_index - first)%2 == 1)? 4 : 2);
+		}
+	}
 }
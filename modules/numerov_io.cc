@@ -0,0 +1,731 @@
+#include "numerov_io.h"
+
+// NOTE: The ratio file ends its header with the matching radius, i.e., the last grid
+// point visited, see numerov::write_ratio_header(). Its format version is that of
+// numerov::FORMAT_VERSION.
+
+// NOTE: The S-matrix file is the same as written by drivers/smatrix.cc, where each
+// pair of channels starts with (x2 usize, 16 bytes) + (x14 s32, 56 bytes) + (x2 f64,
+// 16 bytes), followed by (x1 usize, 8 bytes) + (x3 f64, 24 bytes) per energy.
+constexpr u8 SMATRIX_FORMAT_VERSION = 3;
+
+constexpr usize SMATRIX_PAIR_HEADER = 2*sizeof(usize) + 14*sizeof(s32) + 2*sizeof(f64);
+
+constexpr usize SMATRIX_ENTRY = sizeof(usize) + 3*sizeof(f64);
+
+// NOTE: The file of S-matrices at intermediate matching radii has its own format,
+// see match_offset().
+constexpr u8 MATCH_FORMAT_VERSION = 1;
+
+// NOTE: The same holds for the Richardson-extrapolated reaction matrices, see
+// richardson_offset().
+constexpr u8 RICHARDSON_FORMAT_VERSION = 1;
+
+// NOTE: Checkpoint files are written by each MPI process with the same magic
+// number of all other Numerov files, but with their own format version.
+constexpr u8 CHECKPOINT_FORMAT_VERSION = 2;
+
+//
+// Public API:
+//
+
+void numerov::copy_ratio(const numerov::Potential &coupling,
+                         const Vec<numerov::RatioBatch> &ratio, usize energy_index, Mat<f64> &result)
+{
+	// NOTE: Assembles the full ratio matrix of one energy from its diagonal blocks.
+	// Channels of different blocks are uncoupled, and so are their ratio elements.
+
+	result = 0.0;
+
+	for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+		auto &value = ratio[block][energy_index];
+
+		for (mut<usize> a = 0; a < value.rows(); ++a) {
+			usize channel_a = coupling.block_channel(block, a);
+
+			for (mut<usize> b = 0; b < value.cols(); ++b) {
+				result(channel_a, coupling.block_channel(block, b)) = value(a, b);
+			}
+		}
+	}
+}
+
+void numerov::checkpoint_filename(c_str prefix, u32 rank, usize slot, String &filename)
+{
+	filename.clear();
+	filename.append(prefix, ".mpi", rank, ".", slot);
+}
+
+static usize checkpoint_size(const numerov::Potential &coupling,
+                             usize energy_count, bool use_adaptive_step, bool use_pruning)
+{
+	// NOTE: The size in bytes of a complete checkpoint file, used to detect files
+	// left incomplete by a process that was killed while writing them.
+
+	usize channel_count = coupling.channel_count();
+
+	mut<usize> size = sizeof(numerov::MAGIC_NUMBER) + sizeof(CHECKPOINT_FORMAT_VERSION)
+	                + 7*sizeof(usize) + 3*sizeof(f64) + energy_count*sizeof(f64);
+
+	for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+		usize block_size = coupling.block_size(block);
+
+		size += (use_adaptive_step? 2 : 1)*energy_count*block_size*block_size*sizeof(f64);
+
+		if (use_pruning) {
+			size += energy_count*(block_size + 1)*sizeof(usize);
+		}
+	}
+
+	if (use_adaptive_step) {
+		size += 2*channel_count*channel_count*sizeof(f64);
+	}
+
+	return size + sizeof(usize);
+}
+
+void numerov::write_checkpoint(c_str filename,
+                               u32 world_size,
+                               const numerov::Progress &progress,
+                               const Vec<f64> &energy,
+                               const numerov::Potential &coupling,
+                               const Vec<numerov::RatioBatch> &ratio,
+                               const Vec<numerov::RatioBatch> &prev_ratio,
+                               const Vec<numerov::ActiveSet> &active,
+                               const Mat<f64> &past_potential,
+                               const Mat<f64> &last_potential,
+                               bool use_adaptive_step, bool use_pruning)
+{
+	// NOTE: Only the state needed to resume the propagation after the current grid
+	// point is saved. The previous ratio matrices hold R(n - 1)^-1 and are only
+	// used when doubling the step, as are the last two visited potentials. The
+	// grid index is written again at the end of the file to mark it as complete.
+
+	file::Output output(filename);
+
+	output.write(numerov::MAGIC_NUMBER);
+	output.write(CHECKPOINT_FORMAT_VERSION);
+	output.write(as_usize(world_size));
+	output.write(coupling.channel_count());
+	output.write(energy.length());
+	output.write(progress.next_index);
+	output.write(progress.visit_count);
+	output.write(progress.multiple);
+	output.write(progress.step);
+	output.write(progress.R_max);
+	output.write(progress.max_error);
+	output.write(as_usize(progress.is_step_fixed? 1 : 0));
+	output.write(energy);
+
+	for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+		for (mut<usize> n = 0; n < energy.length(); ++n) {
+			output.write(ratio[block][n]);
+
+			if (use_adaptive_step) {
+				output.write(prev_ratio[block][n]);
+			}
+		}
+
+		// NOTE: Active channels are padded with zeros up to the block size, so
+		// that the file size does not depend on the progress of the pruning.
+		if (use_pruning) {
+			for (mut<usize> n = 0; n < energy.length(); ++n) {
+				output.write(active[block].count(n));
+
+				for (mut<usize> m = 0; m < coupling.block_size(block); ++m) {
+					output.write((m < active[block].count(n))? active[block].channel(n, m) : as_usize(0));
+				}
+			}
+		}
+	}
+
+	if (use_adaptive_step) {
+		output.write(past_potential);
+		output.write(last_potential);
+	}
+
+	output.write(progress.next_index);
+}
+
+usize numerov::find_checkpoint(c_str filename,
+                               u32 world_size,
+                               const Vec<f64> &energy,
+                               const numerov::Potential &coupling,
+                               bool use_adaptive_step, bool use_pruning)
+{
+	// NOTE: Returns the grid index to resume from as saved in a checkpoint file, or
+	// zero if the file is missing, incomplete, or from a different calculation.
+
+	std::FILE *stream = std::fopen(filename, "rb");
+
+	if (stream == nullptr) {
+		return 0;
+	}
+
+	std::fclose(stream);
+
+	file::Input input(filename);
+
+	if (input.size() != checkpoint_size(coupling, energy.length(), use_adaptive_step, use_pruning)) {
+		return 0;
+	}
+
+	mut<decltype(numerov::MAGIC_NUMBER)> tag = 0;
+	input.read(tag);
+
+	mut<decltype(CHECKPOINT_FORMAT_VERSION)> ver = 0;
+	input.read(ver);
+
+	mut<usize> saved_world_size = 0, channel_count = 0, energy_count = 0;
+	input.read(saved_world_size);
+	input.read(channel_count);
+	input.read(energy_count);
+
+	if ((tag != numerov::MAGIC_NUMBER) || (ver != CHECKPOINT_FORMAT_VERSION) || (saved_world_size != world_size)
+	    || (channel_count != coupling.channel_count()) || (energy_count != energy.length())) {
+		return 0;
+	}
+
+	numerov::Progress progress = {0, 0, 0, 0.0, 0.0, 0.0, false};
+	input.read(progress.next_index);
+	input.read(progress.visit_count);
+	input.read(progress.multiple);
+	input.read(progress.step);
+	input.read(progress.R_max);
+	input.read(progress.max_error);
+
+	mut<usize> is_step_fixed = 0;
+	input.read(is_step_fixed);
+
+	mut<f64> value = 0.0;
+
+	for (mut<usize> n = 0; n < energy_count; ++n) {
+		input.read(value);
+
+		if (value != energy[n]) {
+			return 0;
+		}
+	}
+
+	mut<usize> end_index = 0;
+	input.seek_set(input.size() - sizeof(usize));
+	input.read(end_index);
+
+	return ((end_index == progress.next_index)? progress.next_index : 0);
+}
+
+void numerov::read_checkpoint(c_str filename,
+                              const numerov::Potential &coupling,
+                              numerov::Progress &progress,
+                              Vec<numerov::RatioBatch> &ratio,
+                              Vec<numerov::RatioBatch> &prev_ratio,
+                              Vec<numerov::ActiveSet> &active,
+                              Mat<f64> &past_potential,
+                              Mat<f64> &last_potential,
+                              bool use_adaptive_step, bool use_pruning)
+{
+	// NOTE: The file is assumed to be validated by numerov::find_checkpoint()
+	// beforehand.
+
+	file::Input input(filename);
+
+	input.seek_set(sizeof(numerov::MAGIC_NUMBER) + sizeof(CHECKPOINT_FORMAT_VERSION) + 2*sizeof(usize));
+
+	mut<usize> energy_count = 0;
+	input.read(energy_count);
+
+	input.read(progress.next_index);
+	input.read(progress.visit_count);
+	input.read(progress.multiple);
+	input.read(progress.step);
+	input.read(progress.R_max);
+	input.read(progress.max_error);
+
+	mut<usize> is_step_fixed = 0;
+	input.read(is_step_fixed);
+
+	progress.is_step_fixed = (is_step_fixed == 1);
+
+	Vec<f64> energy(energy_count);
+	input.read(energy);
+
+	for (mut<usize> block = 0; block < coupling.block_count(); ++block) {
+		for (mut<usize> n = 0; n < energy_count; ++n) {
+			input.read(ratio[block][n]);
+
+			if (use_adaptive_step) {
+				input.read(prev_ratio[block][n]);
+			}
+		}
+
+		// NOTE: Channels are pruned in their original order, thus the saved active
+		// list is an ordered subset of the full one, which is restored by removal.
+		if (use_pruning) {
+			usize block_size = coupling.block_size(block);
+
+			numerov::ActiveSet active_set(block_size, energy_count);
+			active[block].swap(active_set);
+
+			Vec<usize> saved(block_size);
+
+			for (mut<usize> n = 0; n < energy_count; ++n) {
+				mut<usize> saved_count = 0;
+				input.read(saved_count);
+				input.read(saved);
+
+				mut<usize> k = 0;
+				mut<usize> m = 0;
+
+				while (m < active[block].count(n)) {
+					if ((k < saved_count) && (active[block].channel(n, m) == saved[k])) {
+						++k;
+						++m;
+					} else {
+						active[block].remove(n, m);
+					}
+				}
+			}
+		}
+	}
+
+	if (use_adaptive_step) {
+		input.read(past_potential);
+		input.read(last_potential);
+	}
+
+	if (input.end()) {
+		print::error(WHERE, "Unexpected end of file when reading ", filename);
+	}
+}
+
+usize numerov::chunk_length(usize remaining, u32 worker_count, usize min_length)
+{
+	// NOTE: Guided scheduling, where chunks shrink as fewer energies remain, so that
+	// the last chunks are small and all processes finish at about the same time.
+
+	usize length = remaining/(2*as_usize(worker_count));
+
+	return std::min(remaining, std::max(length, min_length));
+}
+
+usize numerov::receive_chunk(const mpi::Frontend &mpi, const Range<f64> &energy_list,
+                             Vec<numerov::Job> &result, Vec<f64> &local_energy)
+{
+	mut<usize> first = 0, length = 0;
+
+	mpi.receive(mpi::MASTER_PROCESS_RANK, first);
+	mpi.receive(mpi::MASTER_PROCESS_RANK, length);
+
+	assert(length <= result.length());
+
+	for (mut<usize> n = 0; n < length; ++n) {
+		result[n].index = first + n;
+		result[n].energy = energy_list[first + n];
+
+		local_energy[n] = energy_list[first + n];
+	}
+
+	return length;
+}
+
+void numerov::send_chunk(const mpi::Frontend &mpi, usize count, const numerov::Progress &progress)
+{
+	mpi.send(mpi::MASTER_PROCESS_RANK, count);
+
+	if (count > 0) {
+		mpi.send(mpi::MASTER_PROCESS_RANK, progress.step);
+		mpi.send(mpi::MASTER_PROCESS_RANK, progress.R_max);
+	}
+}
+
+numerov::Progress numerov::coordinate_chunks(const mpi::Frontend &mpi,
+                                             const Range<f64> &R_list,
+                                             const Range<f64> &energy_list, usize min_length)
+{
+	// NOTE: Hands out chunks of energies to the other MPI processes as they ask for
+	// them. Each process writes the results of its previous chunk to the output
+	// before asking, see numerov::write_ratio_entries(), thus the output is the
+	// same as that of the static scheduling. Returns the final step of the
+	// propagation and its last grid point, which are the same for all energies,
+	// but not known beforehand with the adaptive step.
+
+	usize energy_count = energy_list.count();
+
+	u32 worker_count = mpi.world_size() - 1;
+
+	mut<u32> active_count = worker_count;
+	mut<usize> next_task = 0;
+	numerov::Progress progress = {0, 0, 1, R_list.step, R_list.min, 0.0, false};
+
+	while (active_count > 0) {
+		u32 rank = mpi.probe();
+
+		mut<usize> count = 0;
+		mpi.receive(rank, count);
+
+		if (count > 0) {
+			mpi.receive(rank, progress.step);
+			mpi.receive(rank, progress.R_max);
+		}
+
+		usize length = (next_task < energy_count? numerov::chunk_length(energy_count - next_task, worker_count, min_length)
+		                                         : 0);
+
+		mpi.send(rank, next_task);
+		mpi.send(rank, length);
+
+		next_task += length;
+
+		// NOTE: An empty chunk lets the process know that there is no work left.
+		if (length == 0) {
+			--active_count;
+		}
+	}
+
+	return progress;
+}
+
+static usize ratio_offset(usize channel_count, usize energy_index)
+{
+	// NOTE: Entries of the output file are stored in the order of their energy
+	// index, after the header, see numerov::write_ratio_header(), regardless of
+	// which process has written them.
+
+	usize header_size = sizeof(numerov::MAGIC_NUMBER) + sizeof(numerov::FORMAT_VERSION)
+	                  + sizeof(usize) + sizeof(f64) + 2*sizeof(Range<f64>) + sizeof(f64);
+
+	usize entry_size = sizeof(usize) + sizeof(f64) + channel_count*channel_count*sizeof(f64);
+
+	return header_size + energy_index*entry_size;
+}
+
+void numerov::write_ratio_header(mpi::File &solution,
+                                 usize channel_count,
+                                 f64 mass,
+                                 const Range<f64> &R_list,
+                                 const numerov::Progress &progress, const Range<f64> &energy_list)
+{
+	// NOTE: Ratio matrices relate the wavefunction at R_max + step to that at R_max,
+	// the last grid point visited, thus R_max is written as their matching radius,
+	// along with the final step.
+
+	solution.seek_set();
+	solution.write(numerov::MAGIC_NUMBER);
+	solution.write(numerov::FORMAT_VERSION);
+	solution.write(channel_count);
+	solution.write(mass);
+	solution.write(Range<f64>(R_list.min, R_list.max, progress.step));
+	solution.write(energy_list);
+	solution.write(progress.R_max);
+}
+
+void numerov::write_ratio_entries(mpi::File &solution,
+                                  const numerov::Potential &coupling,
+                                  const Vec<numerov::RatioBatch> &ratio,
+                                  const Vec<numerov::Job> &result, usize count, Mat<f64> &buffer)
+{
+	for (mut<usize> n = 0; n < count; ++n) {
+		numerov::copy_ratio(coupling, ratio, n, buffer);
+
+		solution.seek_set(ratio_offset(coupling.channel_count(), result[n].index));
+		solution.write(result[n].index);
+		solution.write(result[n].energy);
+		solution.write(buffer);
+	}
+}
+
+static usize smatrix_offset(usize channel_count, usize energy_count, usize channel_a, usize channel_b)
+{
+	usize header_size = sizeof(numerov::MAGIC_NUMBER) + sizeof(SMATRIX_FORMAT_VERSION)
+	                  + 2*sizeof(usize) + sizeof(f64);
+
+	usize pair_size = SMATRIX_PAIR_HEADER + energy_count*SMATRIX_ENTRY;
+
+	return header_size + (channel_a*channel_count + channel_b)*pair_size;
+}
+
+void numerov::write_smatrix_header(file::Output &smatrix,
+                                   const numerov::Basis &basis, usize energy_count, f64 mass)
+{
+	usize channel_count = basis.list.length();
+
+	smatrix.seek_set();
+	smatrix.write(numerov::MAGIC_NUMBER);
+	smatrix.write(SMATRIX_FORMAT_VERSION);
+	smatrix.write(channel_count);
+	smatrix.write(energy_count);
+	smatrix.write(mass);
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			smatrix.seek_set(smatrix_offset(channel_count, energy_count, channel_a, channel_b));
+
+			smatrix.write(channel_a);
+			smatrix.write(channel_b);
+
+			smatrix.write(basis.list[channel_a].n);
+			smatrix.write(basis.list[channel_a].v);
+			smatrix.write(basis.list[channel_a].j);
+			smatrix.write(basis.list[channel_a].J);
+			smatrix.write(basis.list[channel_a].l);
+			smatrix.write(basis.list[channel_a].p);
+			smatrix.write(basis.list[channel_a].c);
+			smatrix.write(basis.list[channel_a].eigenval);
+
+			smatrix.write(basis.list[channel_b].n);
+			smatrix.write(basis.list[channel_b].v);
+			smatrix.write(basis.list[channel_b].j);
+			smatrix.write(basis.list[channel_b].J);
+			smatrix.write(basis.list[channel_b].l);
+			smatrix.write(basis.list[channel_b].p);
+			smatrix.write(basis.list[channel_b].c);
+			smatrix.write(basis.list[channel_b].eigenval);
+		}
+	}
+}
+
+static void build_local_smatrix(f64 mass,
+                                f64 step,
+                                f64 R_max,
+                                const numerov::Basis &basis,
+                                const numerov::Potential &coupling,
+                                const Vec<numerov::RatioBatch> &ratio,
+                                const Vec<numerov::Job> &result,
+                                usize count,
+                                Vec<numerov::Workspace> &workspace,
+                                numerov::RatioBatch &re_s, numerov::RatioBatch &im_s)
+{
+	// NOTE: Builds the full S-matrices of all local energies from the current ratio
+	// matrices of every block, as if R_max was the last grid point.
+
+	usize channel_count = coupling.channel_count();
+
+	numerov::RatioBatch full_ratio(channel_count, count);
+
+	Vec<f64> energy(count);
+
+	for (mut<usize> n = 0; n < count; ++n) {
+		numerov::copy_ratio(coupling, ratio, n, full_ratio[n]);
+		energy[n] = result[n].energy;
+	}
+
+	numerov::build_scatt_matrix(mass, step, R_max, energy, full_ratio, basis, workspace, re_s, im_s);
+}
+
+void numerov::write_smatrix_entries(mpi::File &smatrix,
+                                    f64 mass,
+                                    f64 step,
+                                    f64 R_max,
+                                    const numerov::Basis &basis,
+                                    const numerov::Potential &coupling,
+                                    const Vec<numerov::RatioBatch> &ratio,
+                                    const Vec<numerov::Job> &result,
+                                    usize count,
+                                    usize active_count,
+                                    numerov::RatioBatch &react,
+                                    usize energy_count,
+                                    Vec<numerov::Workspace> &workspace)
+{
+	// NOTE: Builds the S-matrices of all local energies and writes their elements
+	// at their position in the file. Energies of a process are mostly consecutive,
+	// thus the position indicator is only moved when the next one is not. Those
+	// from active_count on were stopped early, and their S-matrices are built from
+	// the reaction matrices in react, kept when they converged.
+
+	if (count == 0) {
+		return;
+	}
+
+	usize channel_count = coupling.channel_count();
+
+	numerov::RatioBatch re_s(channel_count, count);
+	numerov::RatioBatch im_s(channel_count, count);
+
+	if (active_count > 0) {
+		numerov::RatioBatch active_re_s(re_s, 0, active_count), active_im_s(im_s, 0, active_count);
+
+		build_local_smatrix(mass, step, R_max, basis, coupling, ratio, result, active_count, workspace,
+		                    active_re_s, active_im_s);
+	}
+
+	if (active_count < count) {
+		Vec<f64> energy(count - active_count);
+
+		for (mut<usize> n = active_count; n < count; ++n) {
+			energy[n - active_count] = result[n].energy;
+		}
+
+		numerov::RatioBatch stopped_react(react, active_count, count);
+		numerov::RatioBatch stopped_re_s(re_s, active_count, count), stopped_im_s(im_s, active_count, count);
+
+		numerov::build_scatt_matrix(energy, stopped_react, basis, workspace, stopped_re_s, stopped_im_s);
+	}
+
+	for (mut<usize> channel_a = 0; channel_a < channel_count; ++channel_a) {
+		for (mut<usize> channel_b = 0; channel_b < channel_count; ++channel_b) {
+			usize offset = smatrix_offset(channel_count, energy_count, channel_a, channel_b) + SMATRIX_PAIR_HEADER;
+
+			mut<usize> next_index = energy_count;
+
+			for (mut<usize> n = 0; n < count; ++n) {
+				if (result[n].index != next_index) {
+					smatrix.seek_set(offset + result[n].index*SMATRIX_ENTRY);
+				}
+
+				smatrix.write(result[n].index);
+				smatrix.write(result[n].energy);
+				smatrix.write(re_s[n](channel_a, channel_b));
+				smatrix.write(im_s[n](channel_a, channel_b));
+
+				next_index = result[n].index + 1;
+			}
+		}
+	}
+}
+
+static usize match_offset(usize channel_count, usize energy_count, usize radius_index, usize energy_index)
+{
+	// NOTE: The header (magic number, format version, channel count, reduced mass,
+	// range of requested radii, and range of energies) is followed by one entry
+	// per radius and energy, in this order, each one with the energy index, the
+	// actual matching radius, the energy, and the real and imaginary parts of the
+	// full S-matrix (zero for closed channels).
+
+	usize header_size = sizeof(numerov::MAGIC_NUMBER) + sizeof(MATCH_FORMAT_VERSION)
+	                  + sizeof(usize) + sizeof(f64) + 2*sizeof(Range<f64>);
+
+	usize entry_size = sizeof(usize) + 2*sizeof(f64) + 2*channel_count*channel_count*sizeof(f64);
+
+	return header_size + (radius_index*energy_count + energy_index)*entry_size;
+}
+
+void numerov::write_match_header(file::Output &match,
+                                 usize channel_count,
+                                 f64 mass, const Range<f64> &match_list, const Range<f64> &energy_list)
+{
+	match.seek_set();
+	match.write(numerov::MAGIC_NUMBER);
+	match.write(MATCH_FORMAT_VERSION);
+	match.write(channel_count);
+	match.write(mass);
+	match.write(match_list);
+	match.write(energy_list);
+}
+
+void numerov::write_match_entries(mpi::File &match,
+                                  usize radius_index,
+                                  f64 mass,
+                                  f64 step,
+                                  f64 R_max,
+                                  const numerov::Basis &basis,
+                                  const numerov::Potential &coupling,
+                                  const Vec<numerov::RatioBatch> &ratio,
+                                  const Vec<numerov::Job> &result,
+                                  usize count,
+                                  usize energy_count,
+                                  Vec<numerov::Workspace> &workspace)
+{
+	if (count == 0) {
+		return;
+	}
+
+	usize channel_count = coupling.channel_count();
+
+	numerov::RatioBatch re_s(channel_count, count);
+	numerov::RatioBatch im_s(channel_count, count);
+
+	build_local_smatrix(mass, step, R_max, basis, coupling, ratio, result, count, workspace, re_s, im_s);
+
+	for (mut<usize> n = 0; n < count; ++n) {
+		match.seek_set(match_offset(channel_count, energy_count, radius_index, result[n].index));
+		match.write(result[n].index);
+		match.write(R_max);
+		match.write(result[n].energy);
+		match.write(re_s[n]);
+		match.write(im_s[n]);
+	}
+}
+
+static usize richardson_offset(usize channel_count, usize energy_index)
+{
+	// NOTE: The header (magic number, format version, channel count, reduced mass,
+	// grid range, and range of energies) is followed by one entry per energy, each
+	// one with the energy index, the energy, the extrapolated reaction matrix, and
+	// the error estimate of every channel (zero for closed ones).
+
+	usize header_size = sizeof(numerov::MAGIC_NUMBER) + sizeof(RICHARDSON_FORMAT_VERSION)
+	                  + sizeof(usize) + sizeof(f64) + 2*sizeof(Range<f64>);
+
+	usize entry_size = sizeof(usize) + sizeof(f64) + (channel_count + 1)*channel_count*sizeof(f64);
+
+	return header_size + energy_index*entry_size;
+}
+
+void numerov::write_richardson_header(file::Output &richardson,
+                                      usize channel_count,
+                                      f64 mass, const Range<f64> &R_list, const Range<f64> &energy_list)
+{
+	richardson.seek_set();
+	richardson.write(numerov::MAGIC_NUMBER);
+	richardson.write(RICHARDSON_FORMAT_VERSION);
+	richardson.write(channel_count);
+	richardson.write(mass);
+	richardson.write(R_list);
+	richardson.write(energy_list);
+}
+
+void numerov::write_richardson_entries(mpi::File &richardson,
+                                       f64 mass,
+                                       f64 step,
+                                       f64 R_max,
+                                       const numerov::Basis &basis,
+                                       const numerov::Potential &coupling,
+                                       const Vec<numerov::RatioBatch> &ratio,
+                                       const Vec<numerov::RatioBatch> &coarse_ratio,
+                                       const Vec<numerov::Job> &result,
+                                       usize count,
+                                       numerov::Workspace &workspace)
+{
+	// NOTE: The global error of the renormalized Numerov method is O(h^4), thus the
+	// reaction matrices K(h) and K(2h) of both propagations are extrapolated as
+	// K = K(h) + [K(h) - K(2h)]/15, and the error of K(h) in each open channel a
+	// is estimated by the largest |K(h) - K(2h)|/15 among the elements ab of the
+	// open-open block.
+
+	usize channel_count = coupling.channel_count();
+
+	Mat<f64> buffer(channel_count, channel_count);
+	Mat<f64> k(channel_count, channel_count), coarse_k(channel_count, channel_count);
+	Vec<f64> error(channel_count);
+
+	for (mut<usize> n = 0; n < count; ++n) {
+		numerov::copy_ratio(coupling, ratio, n, buffer);
+		numerov::build_react_matrix(mass, step, R_max, result[n].energy, buffer, basis, workspace, k);
+
+		numerov::copy_ratio(coupling, coarse_ratio, n, buffer);
+		numerov::build_react_matrix(mass, 2.0*step, R_max, result[n].energy, buffer, basis, workspace, coarse_k);
+
+		for (mut<usize> a = 0; a < channel_count; ++a) {
+			error[a] = 0.0;
+
+			for (mut<usize> b = 0; b < channel_count; ++b) {
+				f64 diff = (k(a, b) - coarse_k(a, b))/15.0;
+
+				bool is_open = (basis.list[a].eigenval < result[n].energy)
+				            && (basis.list[b].eigenval < result[n].energy);
+
+				if (is_open && (std::abs(diff) > error[a])) {
+					error[a] = std::abs(diff);
+				}
+
+				k(a, b) += diff;
+			}
+		}
+
+		richardson.seek_set(richardson_offset(channel_count, result[n].index));
+		richardson.write(result[n].index);
+		richardson.write(result[n].energy);
+		richardson.write(k);
+		richardson.write(error);
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "essentials.h"
+#include "libmpi.h"
+#include "numerov.h"
+
+namespace numerov {
+	// NOTE: A collision energy of the output, along with its index in the list of
+	// all energies requested.
+	struct Job {
+		mut<usize> index;
+		mut<f64> energy;
+	};
+
+	// NOTE: The state of a propagation after its last visited grid point, i.e.,
+	// the index of the next one, the number of points visited so far, the multiple
+	// of the grid step in use, that step, the last point, the largest estimated
+	// error of the step, and whether the step may not be doubled anymore.
+	struct Progress {
+		mut<usize> next_index;
+		mut<usize> visit_count;
+		mut<usize> multiple;
+		mut<f64> step;
+		mut<f64> R_max;
+		mut<f64> max_error;
+		mut<bool> is_step_fixed;
+	};
+
+	void copy_ratio(const numerov::Potential &coupling,
+	                const Vec<numerov::RatioBatch> &ratio, usize energy_index, Mat<f64> &result);
+
+	void checkpoint_filename(c_str prefix, u32 rank, usize slot, String &filename);
+
+	void write_checkpoint(c_str filename,
+	                      u32 world_size,
+	                      const numerov::Progress &progress,
+	                      const Vec<f64> &energy,
+	                      const numerov::Potential &coupling,
+	                      const Vec<numerov::RatioBatch> &ratio,
+	                      const Vec<numerov::RatioBatch> &prev_ratio,
+	                      const Vec<numerov::ActiveSet> &active,
+	                      const Mat<f64> &past_potential,
+	                      const Mat<f64> &last_potential,
+	                      bool use_adaptive_step, bool use_pruning);
+
+	usize find_checkpoint(c_str filename,
+	                      u32 world_size,
+	                      const Vec<f64> &energy,
+	                      const numerov::Potential &coupling,
+	                      bool use_adaptive_step, bool use_pruning);
+
+	void read_checkpoint(c_str filename,
+	                     const numerov::Potential &coupling,
+	                     numerov::Progress &progress,
+	                     Vec<numerov::RatioBatch> &ratio,
+	                     Vec<numerov::RatioBatch> &prev_ratio,
+	                     Vec<numerov::ActiveSet> &active,
+	                     Mat<f64> &past_potential,
+	                     Mat<f64> &last_potential,
+	                     bool use_adaptive_step, bool use_pruning);
+
+	usize chunk_length(usize remaining, u32 worker_count, usize min_length);
+
+	usize receive_chunk(const mpi::Frontend &mpi, const Range<f64> &energy_list,
+	                    Vec<numerov::Job> &result, Vec<f64> &local_energy);
+
+	void send_chunk(const mpi::Frontend &mpi, usize count, const numerov::Progress &progress);
+
+	numerov::Progress coordinate_chunks(const mpi::Frontend &mpi,
+	                                    const Range<f64> &R_list,
+	                                    const Range<f64> &energy_list, usize min_length);
+
+	void write_ratio_header(mpi::File &solution,
+	                        usize channel_count,
+	                        f64 mass,
+	                        const Range<f64> &R_list,
+	                        const numerov::Progress &progress, const Range<f64> &energy_list);
+
+	void write_ratio_entries(mpi::File &solution,
+	                         const numerov::Potential &coupling,
+	                         const Vec<numerov::RatioBatch> &ratio,
+	                         const Vec<numerov::Job> &result, usize count, Mat<f64> &buffer);
+
+	void write_smatrix_header(file::Output &smatrix,
+	                          const numerov::Basis &basis, usize energy_count, f64 mass);
+
+	void write_smatrix_entries(mpi::File &smatrix,
+	                           f64 mass,
+	                           f64 step,
+	                           f64 R_max,
+	                           const numerov::Basis &basis,
+	                           const numerov::Potential &coupling,
+	                           const Vec<numerov::RatioBatch> &ratio,
+	                           const Vec<numerov::Job> &result,
+	                           usize count,
+	                           usize active_count,
+	                           numerov::RatioBatch &react,
+	                           usize energy_count,
+	                           Vec<numerov::Workspace> &workspace);
+
+	void write_match_header(file::Output &match,
+	                        usize channel_count,
+	                        f64 mass, const Range<f64> &match_list, const Range<f64> &energy_list);
+
+	void write_match_entries(mpi::File &match,
+	                         usize radius_index,
+	                         f64 mass,
+	                         f64 step,
+	                         f64 R_max,
+	                         const numerov::Basis &basis,
+	                         const numerov::Potential &coupling,
+	                         const Vec<numerov::RatioBatch> &ratio,
+	                         const Vec<numerov::Job> &result,
+	                         usize count,
+	                         usize energy_count,
+	                         Vec<numerov::Workspace> &workspace);
+
+	void write_richardson_header(file::Output &richardson,
+	                             usize channel_count,
+	                             f64 mass, const Range<f64> &R_list, const Range<f64> &energy_list);
+
+	void write_richardson_entries(mpi::File &richardson,
+	                              f64 mass,
+	                              f64 step,
+	                              f64 R_max,
+	                              const numerov::Basis &basis,
+	                              const numerov::Potential &coupling,
+	                              const Vec<numerov::RatioBatch> &ratio,
+	                              const Vec<numerov::RatioBatch> &coarse_ratio,
+	                              const Vec<numerov::Job> &result,
+	                              usize count,
+	                              numerov::Workspace &workspace);
+}
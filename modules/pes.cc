@@ -1,5 +1,10 @@
 #include "pes.h"
 #include "math.h"
+#include "libblas.h"
+
+// NOTE: Order of the Gauss-Legendre quadrature in theta of the Legendre multipole
+// terms.
+static constexpr u8 LEGENDRE_ORDER = 64;
 
 //
 // pes::Frontend:
@@ -69,7 +74,8 @@ void pes::Frontend::start_extern_pes(c_str filename)
 }
 
 pes::Frontend::Frontend(const String &filename, const nist::Isotope a, const nist::Isotope b, const nist::Isotope c):
-	extern_pes(filename.as_cstr()), a(a), b(b), c(c), mass_a(0.0), mass_b(0.0), mass_c(0.0)
+	extern_pes(filename.as_cstr()), a(a), b(b), c(c), mass_a(0.0), mass_b(0.0), mass_c(0.0),
+	asymptotic_arrang('\0'), asymptotic_r_list(0.0, 0.0, 0.0), asymptotic_value(0, 0)
 {
 	// NOTE: Atomic masses are stored in atomic units.
 	this->mass_a = nist::atomic_mass(a)*nist::ATOMIC_MASS_TO_ATOMIC_UNIT;
@@ -229,7 +235,7 @@ f64 pes::Frontend::legendre_multipole_term(const char arrang, u32 lambda, f64 r,
 
 	Legendre params = {*this, arrang, lambda, r, R};
 
-	f64 result = math::gauss_legendre(0.0, math::PI, 64, as_void(&params), integrand);
+	f64 result = math::gauss_legendre(0.0, math::PI, LEGENDRE_ORDER, as_void(&params), integrand);
 
 	// NOTE: Eq. (22) of [1].
 	return as_f64(2*lambda + 1)*result/2.0;
@@ -245,6 +251,86 @@ void pes::Frontend::legendre_multipole_term(const char arrang, u32 lambda,
 	}
 }
 
+void pes::Frontend::legendre_multipole_term(const char arrang, const Range<u32> &lambda_list,
+                                            const Range<f64> &r_list, f64 R, Mat<f64> &result)
+{
+	// References:
+	// [1] W. H. Miller, J. Chem. Phys., Vol. 50, Num. 1, 407-418 (1969)
+
+	// NOTE: Same as above for all lambdas at once, where the n-th row of the result
+	// holds the terms of the n-th lambda. The PES is evaluated only once per (r,
+	// theta) node of the quadrature, and projected onto every Legendre polynomial
+	// as the product of a (lambda, theta) matrix of weighted polynomials, including
+	// the (2 lambda + 1)/2 factor of Eq. (22) of [1], and a (theta, r) matrix of
+	// potentials. The asymptotic reference, at R = 1000 a.u., is the same for all R
+	// and lambdas, thus it is only evaluated on the first call for a given grid of r
+	// values, and then kept by the frontend.
+
+	mut<usize> lambda_count = 0;
+
+	for ([[maybe_unused]] u32 lambda : lambda_list.as_range_inclusive()) {
+		++lambda_count;
+	}
+
+	assert(result.rows() == lambda_count);
+	assert(result.cols() == r_list.count());
+
+	Vec<f64> node(LEGENDRE_ORDER), weight(LEGENDRE_ORDER);
+
+	math::gauss_legendre(0.0, math::PI, LEGENDRE_ORDER, node, weight);
+
+	//
+	// Step 1: Build the (lambda, theta) matrix of weighted Legendre polynomials.
+	//
+
+	Mat<f64> projection(lambda_count, LEGENDRE_ORDER);
+
+	mut<usize> lambda_index = 0;
+
+	for (u32 lambda : lambda_list.as_range_inclusive()) {
+		for (mut<u8> n = 0; n < LEGENDRE_ORDER; ++n) {
+			projection(lambda_index, n) = as_f64(2*lambda + 1)/2.0
+			                            *weight[n]*math::legendre_poly(lambda, std::cos(node[n]))*std::sin(node[n]);
+		}
+
+		++lambda_index;
+	}
+
+	//
+	// Step 2: Build the (theta, r) matrix of potentials, with the asymptotic one first
+	// if not kept yet.
+	//
+
+	if ((this->asymptotic_arrang != arrang) || ((this->asymptotic_r_list == r_list) == false)) {
+		this->asymptotic_value.resize(LEGENDRE_ORDER, r_list.count());
+
+		for (auto r : r_list.indexed()) {
+			for (mut<u8> n = 0; n < LEGENDRE_ORDER; ++n) {
+				this->asymptotic_value(n, r.index) = this->value(arrang, r.value, 1000.0, math::as_deg(node[n]));
+			}
+		}
+
+		this->asymptotic_arrang = arrang;
+		this->asymptotic_r_list = r_list;
+	}
+
+	Mat<f64> potential(LEGENDRE_ORDER, r_list.count());
+
+	for (auto r : r_list.indexed()) {
+		for (mut<u8> n = 0; n < LEGENDRE_ORDER; ++n) {
+			f64 x = math::as_deg(node[n]);
+
+			potential(n, r.index) = this->asymptotic_value(n, r.index) - this->value(arrang, r.value, R, x);
+		}
+	}
+
+	//
+	// Step 3: Project the potentials onto all Legendre polynomials.
+	//
+
+	blas::gemm('n', 'n', projection, potential, result);
+}
+
 pes::Frontend::~Frontend()
 {
 	// NOTE: This is the last call to the external PES library. It may be thread-unsafe.
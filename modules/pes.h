@@ -65,6 +65,9 @@ namespace pes {
 		void legendre_multipole_term(const char arrang, u32 lambda,
 		                             const Range<f64> &r_list, f64 R, Vec<f64> &result) const;
 
+		void legendre_multipole_term(const char arrang, const Range<u32> &lambda_list,
+		                             const Range<f64> &r_list, f64 R, Mat<f64> &result);
+
 		~Frontend();
 
 		private:
@@ -78,6 +81,9 @@ namespace pes {
 		pfn_value call_extern_value;
 		pfn_startup call_extern_startup;
 		pfn_shutdown call_extern_shutdown;
+		mut<char> asymptotic_arrang;
+		Range<f64> asymptotic_r_list;
+		Mat<f64> asymptotic_value;
 
 		void start_extern_pes(c_str filename);
 	};
@@ -7,10 +7,10 @@ constexpr u8 PAD = 4;
 
 void call_olson_smith_model(u32 l, f64 mass, f64 R, Mat<f64> &v)
 {
-	v(0, 0) = pes::olson_smith_pra1971(0, 0, R) + numerov::centrifugal_term(l, mass, R);
+	v(0, 0) = pes::olson_smith_pra1971(0, 0, R) + numerov::centrifugal_term(as_f64(l), mass, R);
 	v(0, 1) = pes::olson_smith_pra1971(0, 1, R);
 	v(1, 0) = pes::olson_smith_pra1971(1, 0, R);
-	v(1, 1) = pes::olson_smith_pra1971(1, 1, R) + numerov::centrifugal_term(l, mass, R);
+	v(1, 1) = pes::olson_smith_pra1971(1, 1, R) + numerov::centrifugal_term(as_f64(l), mass, R);
 }
 
 f64 propagate(u32 l)
@@ -43,17 +43,19 @@ f64 propagate(u32 l)
 
 	numerov::Basis level(2);
 
-	level[0].l = l;
-	level[0].eigenval = pes::olson_smith_pra1971(0, 0, R_inf);
+	level.list[0].l = l;
+	level.list[0].eigenval = pes::olson_smith_pra1971(0, 0, R_inf);
 
-	level[1].l = l;
-	level[1].eigenval = pes::olson_smith_pra1971(1, 1, R_inf);
+	level.list[1].l = l;
+	level.list[1].eigenval = pes::olson_smith_pra1971(1, 1, R_inf);
 
 	//
 	// Propagation:
 	//
 
-	Mat<f64> workspace(2, 2), old_ratio(2, 2), ratio(2, 2), pot_energy(2, 2);
+	numerov::Workspace workspace(2);
+
+	Mat<f64> old_ratio(2, 2), ratio(2, 2), pot_energy(2, 2);
 
 	for (mut<u32> n = 0; n <= R_count; ++n) {
 		f64 R = R_min + as_f64(n)*R_step;
@@ -71,11 +73,11 @@ f64 propagate(u32 l)
 
 	Mat<f64> k(2, 2), re_s(2, 2), im_s(2, 2);
 
-	usize count = numerov::build_react_matrix(mass, R_step, R_max, tot_energy, ratio, level, k);
+	usize count = numerov::build_react_matrix(mass, R_step, R_max, tot_energy, ratio, level, workspace, k);
 
 	assert(count == 2);
 
-	numerov::build_scatt_matrix(k, re_s, im_s);
+	numerov::build_scatt_matrix(k, workspace, re_s, im_s);
 
 	//
 	// Probability of transition 1->2:
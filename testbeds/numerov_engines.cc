@@ -0,0 +1,197 @@
+#include "modules/essentials.h"
+#include "modules/numerov.h"
+
+constexpr u8 PAD = 20;
+
+constexpr usize CHANNEL_COUNT = 3;
+
+constexpr f64 TOLERANCE = 1.0E-4;
+
+void call_coupled_morse_model(f64 mass, const numerov::Basis &level, f64 R, Mat<f64> &v)
+{
+	// NOTE: Three Morse wells with asymptotes given by the levels, coupled by
+	// exponential terms that vanish long before the end of the grid, so that the
+	// potential there is only the asymptote plus the centrifugal term.
+
+	for (mut<usize> n = 0; n < CHANNEL_COUNT; ++n) {
+		f64 x = std::exp(-1.2*(R - 2.0 - 0.1*as_f64(n)));
+
+		v(n, n) = 0.05*(x*x - 2.0*x) + level.list[n].eigenval
+		        + numerov::centrifugal_term(level.list[n].l, mass, R);
+	}
+
+	v(0, 1) = v(1, 0) = 0.02*std::exp(-0.8*(R - 2.0));
+	v(0, 2) = v(2, 0) = 0.01*std::exp(-0.8*(R - 2.0));
+	v(1, 2) = v(2, 1) = 0.015*std::exp(-0.8*(R - 2.0));
+}
+
+usize propagate_renormalized(f64 mass,
+                             const Range<f64> &R_list,
+                             f64 energy,
+                             const Vec<Mat<f64>> &potential,
+                             const numerov::Basis &level,
+                             usize doubling_index,
+                             numerov::Workspace &workspace,
+                             Mat<f64> &k)
+{
+	// NOTE: The step is doubled once at the grid point of doubling_index, which
+	// must leave an even number of intervals up to the last point, or never when
+	// it is past the end of the grid.
+
+	Mat<f64> old_ratio(CHANNEL_COUNT, CHANNEL_COUNT), ratio(CHANNEL_COUNT, CHANNEL_COUNT);
+
+	mut<f64> step = R_list.step;
+
+	mut<usize> multiple = 1;
+
+	for (mut<usize> n = 0; n < R_list.count(); n += multiple) {
+		// NOTE: Here, ratio holds R(n - 1) and old_ratio holds R(n - 2)^-1.
+		if (n == doubling_index) {
+			numerov::double_step(mass, step, energy, potential[n - 2], potential[n], workspace, old_ratio, ratio);
+
+			step = 2.0*step;
+			multiple = 2;
+		}
+
+		ratio.swap(old_ratio);
+
+		numerov::renormalized(mass, step, energy, potential[n], workspace, old_ratio, ratio);
+	}
+
+	f64 R_max = R_list[R_list.count() - 1];
+
+	return numerov::build_react_matrix(mass, step, R_max, energy, ratio, level, workspace, k);
+}
+
+usize propagate_log_derivative(f64 mass,
+                               const Range<f64> &R_list,
+                               f64 energy,
+                               const Vec<Mat<f64>> &potential,
+                               const numerov::Basis &level,
+                               numerov::Workspace &workspace,
+                               Mat<f64> &k)
+{
+	Mat<f64> old_y(CHANNEL_COUNT, CHANNEL_COUNT), y(CHANNEL_COUNT, CHANNEL_COUNT);
+
+	usize grid_count = R_list.count();
+
+	for (mut<usize> n = 0; n < grid_count; ++n) {
+		y.swap(old_y);
+
+		numerov::log_derivative(mass, R_list.step, energy, potential[n], numerov::simpson_weight(n, grid_count),
+		                        workspace, old_y, y);
+	}
+
+	Mat<f64> ratio(CHANNEL_COUNT, CHANNEL_COUNT);
+
+	f64 R_max = R_list[grid_count - 1];
+
+	numerov::build_ratio_matrix(mass, R_list.step, R_max, energy, y, level, workspace, ratio);
+
+	return numerov::build_react_matrix(mass, R_list.step, R_max, energy, ratio, level, workspace, k);
+}
+
+f64 open_max_diff(usize open_count, const Mat<f64> &a, const Mat<f64> &b)
+{
+	mut<f64> diff = 0.0;
+
+	for (mut<usize> n = 0; n < open_count; ++n) {
+		for (mut<usize> m = 0; m < open_count; ++m) {
+			diff = std::max(diff, std::abs(a(n, m) - b(n, m)));
+		}
+	}
+
+	return diff;
+}
+
+int main(int argc, char *argv[])
+{
+	//
+	// Reduced mass, asymptotic levels and grid, whose first point lies deep in the
+	// repulsive wall and whose last one lies where the couplings vanish:
+	//
+
+	constexpr f64 mass = 1000.0;
+
+	numerov::Basis level(CHANNEL_COUNT);
+
+	level.list[0].l = 0;
+	level.list[0].eigenval = 0.0;
+
+	level.list[1].l = 1;
+	level.list[1].eigenval = 0.002;
+
+	level.list[2].l = 0;
+	level.list[2].eigenval = 0.008;
+
+	Range<f64> R_list(0.8, 30.0, 0.005);
+
+	usize size = R_list.count();
+
+	Vec<Mat<f64>> potential(size);
+
+	for (auto R : R_list.indexed()) {
+		Mat<f64> v(CHANNEL_COUNT, CHANNEL_COUNT);
+		call_coupled_morse_model(mass, level, R.value, v);
+		potential[R.index].swap(v);
+	}
+
+	// NOTE: Doubling at R = 10 a.u., or the first point after it that leaves an
+	// even number of intervals up to the last point.
+	mut<usize> doubling_index = as_usize((10.0 - R_list.min)/R_list.step);
+
+	if ((size - 1 - doubling_index)%2 != 0) {
+		++doubling_index;
+	}
+
+	//
+	// Comparison: Open-open block of K from the log-derivative engine and from the
+	// renormalized Numerov engine, with and without doubling the step once, with
+	// only the first channel open, then the first two, and then all.
+	//
+
+	Vec<f64> energy(3);
+
+	energy[0] = 0.001;
+	energy[1] = 0.005;
+	energy[2] = 0.012;
+
+	numerov::Workspace workspace(CHANNEL_COUNT);
+
+	print::line("# Test of the reaction matrices of the log-derivative and renormalized Numerov engines");
+	print::line("# Ref. problem: three coupled Morse wells, step of ", R_list.step, " a.u. doubled once at R = ",
+	            R_list[doubling_index], " a.u.");
+	print::line('#');
+	print::line<PAD, '#'>("Energy (a.u.)", "Open channels", "K(0, 0)", "Renormalized", "Doubled step");
+
+	mut<usize> error_count = 0;
+
+	for (mut<usize> n = 0; n < energy.length(); ++n) {
+		Mat<f64> k_log(CHANNEL_COUNT, CHANNEL_COUNT), k_ren(CHANNEL_COUNT, CHANNEL_COUNT), k_dbl(CHANNEL_COUNT, CHANNEL_COUNT);
+
+		usize open_count = propagate_log_derivative(mass, R_list, energy[n], potential, level, workspace, k_log);
+
+		usize ren_count = propagate_renormalized(mass, R_list, energy[n], potential, level, size, workspace, k_ren);
+
+		usize dbl_count = propagate_renormalized(mass, R_list, energy[n], potential, level, doubling_index, workspace, k_dbl);
+
+		assert(open_count == n + 1);
+		assert(ren_count == open_count);
+		assert(dbl_count == open_count);
+
+		f64 ren_diff = open_max_diff(open_count, k_log, k_ren);
+		f64 dbl_diff = open_max_diff(open_count, k_log, k_dbl);
+
+		if ((ren_diff > TOLERANCE) || (dbl_diff > TOLERANCE)) {
+			++error_count;
+		}
+
+		print::line<PAD>(energy[n], open_count, k_log(0, 0), ren_diff, dbl_diff);
+	}
+
+	print::line('#');
+	print::line("# Largest deviation from the log-derivative K allowed: ", TOLERANCE);
+	print::line("# Mismatches: ", error_count);
+
+	return (error_count == 0? EXIT_SUCCESS : EXIT_FAILURE);
+}
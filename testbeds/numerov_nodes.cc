@@ -0,0 +1,134 @@
+#include "modules/essentials.h"
+#include "modules/liblapack.h"
+#include "modules/numerov.h"
+#include "modules/fgh.h"
+
+constexpr u8 PAD = 20;
+
+constexpr usize LEVEL_COUNT = 12;
+
+void call_coupled_oscillator_model(f64 R, Mat<f64> &v)
+{
+	// NOTE: Two harmonic wells of frequency 0.01 a.u. (for a reduced mass of 1000
+	// a.u.), displaced in R and energy, and coupled by a Gaussian term, so that the
+	// levels of both channels are interleaved and mixed.
+
+	f64 k = 0.1;
+
+	v(0, 0) = 0.5*k*(R - 3.3)*(R - 3.3);
+	v(1, 1) = 0.5*k*(R - 3.7)*(R - 3.7) + 0.004;
+	v(0, 1) = v(1, 0) = 0.002*std::exp(-(R - 3.5)*(R - 3.5));
+}
+
+int main(int argc, char *argv[])
+{
+	//
+	// Reduced mass and grid, whose ends lie far in the classically forbidden region
+	// of the lowest levels:
+	//
+
+	constexpr f64 mass = 1000.0;
+
+	Range<f64> R_list(0.5, 6.5, 0.01);
+
+	usize size = R_list.count();
+
+	Vec<Mat<f64>> potential(size);
+
+	for (auto R : R_list.indexed()) {
+		Mat<f64> v(2, 2);
+		call_coupled_oscillator_model(R.value, v);
+		potential[R.index].swap(v);
+	}
+
+	//
+	// Reference levels: Eigenvalues of the FGH Hamiltonian on the same grid.
+	//
+
+	Mat<f64> hamiltonian(2*size, 2*size);
+	Vec<f64> eigenval(2*size);
+
+	fgh::matrix(mass, R_list.step, potential, hamiltonian);
+
+	lapack::syev(hamiltonian, eigenval);
+
+	//
+	// Test energies: One below the lowest level, with no levels below it, and one
+	// between each pair of consecutive levels, with n + 1 levels below it.
+	//
+
+	Vec<f64> energy(LEVEL_COUNT);
+
+	energy[0] = eigenval[0] - 0.5*(eigenval[1] - eigenval[0]);
+
+	for (mut<usize> n = 1; n < LEVEL_COUNT; ++n) {
+		energy[n] = 0.5*(eigenval[n - 1] + eigenval[n]);
+	}
+
+	//
+	// Node count: Batch of all energies at once, as in the bound states driver.
+	//
+
+	Vec<numerov::Workspace> workspace(max_thread_count());
+
+	for (mut<u32> thread = 0; thread < max_thread_count(); ++thread) {
+		numerov::Workspace thread_workspace(2);
+		workspace[thread].swap(thread_workspace);
+	}
+
+	numerov::RatioBatch ratio(2, LEVEL_COUNT), prev_ratio(2, LEVEL_COUNT);
+
+	Vec<s64> batch_count(LEVEL_COUNT);
+
+	for (auto R : R_list.indexed()) {
+		numerov::renormalized_nodes(mass, R_list.step, energy, potential[R.index], workspace, prev_ratio, ratio, batch_count);
+		prev_ratio.swap(ratio);
+	}
+
+	numerov::negative_count(prev_ratio, workspace, batch_count);
+
+	//
+	// Node count: One energy at a time.
+	//
+
+	Vec<s64> single_count(LEVEL_COUNT);
+
+	for (mut<usize> n = 0; n < LEVEL_COUNT; ++n) {
+		Mat<f64> old_ratio(2, 2), new_ratio(2, 2);
+
+		mut<s64> count = 0;
+
+		for (auto R : R_list.indexed()) {
+			count += numerov::renormalized_nodes(mass, R_list.step, energy[n], potential[R.index], workspace[0], old_ratio, new_ratio);
+			old_ratio.swap(new_ratio);
+		}
+
+		single_count[n] = count + as_s64(numerov::negative_count(old_ratio, workspace[0]));
+	}
+
+	//
+	// Comparison:
+	//
+
+	print::line("# Test of the multichannel node count of numerov::renormalized_nodes()");
+	print::line("# Ref. problem: two coupled harmonic wells, levels from the FGH method on the same grid");
+	print::line('#');
+	print::line<PAD, '#'>("Energy (a.u.)", "FGH level (a.u.)", "Expected", "Batch", "Single");
+
+	mut<usize> error_count = 0;
+
+	for (mut<usize> n = 0; n < LEVEL_COUNT; ++n) {
+		s64 expected = as_s64(n);
+
+		if ((batch_count[n] != expected) || (single_count[n] != expected)) {
+			++error_count;
+		}
+
+		print::line<PAD>(energy[n], eigenval[n], expected, batch_count[n], single_count[n]);
+	}
+
+	print::line('#');
+	print::line("# Mismatches: ", error_count);
+
+	return (error_count == 0? EXIT_SUCCESS : EXIT_FAILURE);
+}